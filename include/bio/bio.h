@@ -119,6 +119,14 @@
  */
 typedef void (*bio_entrypoint_t)(void* userdata);
 
+/**
+ * Process the elements in the range [begin, end)
+ *
+ * @ingroup misc
+ * @see bio_parallel_for
+ */
+typedef void (*bio_range_fn_t)(size_t begin, size_t end, void* userdata);
+
 /**
  * @see handle
  * @ingroup handle
@@ -158,6 +166,53 @@ typedef struct {
 	bio_handle_t handle;
 } bio_monitor_t;
 
+/**
+ * Handle to a wait group.
+ *
+ * @ingroup wait_group
+ * @see bio_make_wait_group
+ */
+typedef struct {
+	bio_handle_t handle;
+} bio_wait_group_t;
+
+/**
+ * The kind of thread pool an async job runs in.
+ *
+ * Each kind has its own threads so a handful of blocking jobs cannot hold up
+ * the compute jobs.
+ *
+ * @ingroup misc
+ * @see bio_run_async_ex
+ */
+typedef enum {
+	/// For CPU-bound work, see @ref bio_options_t::thread_pool
+	BIO_ASYNC_COMPUTE = 0,
+	/// For potentially blocking syscalls, see @ref bio_options_t::blocking_pool
+	BIO_ASYNC_BLOCKING,
+} bio_async_pool_t;
+
+/**
+ * A job for the async thread pool.
+ *
+ * @ingroup misc
+ * @see bio_run_async_job
+ */
+typedef struct bio_async_job_s {
+	/// Entrypoint of the job
+	bio_entrypoint_t fn;
+	/// Arbitrary userdata passed to the function
+	void* userdata;
+	/// The signal that will be raised when the job finishes
+	bio_signal_t signal;
+	/// The pool to run the job in, defaults to @ref BIO_ASYNC_COMPUTE
+	bio_async_pool_t pool;
+
+	struct bio_async_job_s* next;  /**< For internal use */
+	struct bio_async_batch_s* batch;  /**< For internal use */
+	bool pooled;  /**< For internal use */
+} bio_async_job_t;
+
 /**
  * Handle to a logger.
  *
@@ -168,6 +223,20 @@ typedef struct {
 	bio_handle_t handle;
 } bio_logger_t;
 
+/**
+ * Reference to an event loop.
+ *
+ * Unlike other handles, this can be passed between threads.
+ * A zero-initialized value does not refer to any loop.
+ *
+ * @ingroup init
+ * @see bio_current_loop
+ * @see bio_spawn_on
+ */
+typedef struct {
+	void* ctx;  /**< For internal use */
+} bio_loop_t;
+
 /**
  * A unique tag
  *
@@ -376,6 +445,83 @@ typedef struct {
 	int current_depth_in_project;
 } bio_log_options_t;
 
+/**
+ * Options for an async thread pool
+ *
+ * @ingroup init
+ * @see bio_options_t
+ */
+typedef struct {
+	/**
+	 * Number of threads started with the thread pool.
+	 *
+	 * Defaults to @ref BIO_DEFAULT_THREAD_POOL_SIZE if not set.
+	 */
+	int num_threads;
+
+	/**
+	 * The initial length of the job queue for each thread in the async thread pool.
+	 *
+	 * Defaults to @ref BIO_DEFAULT_THREAD_POOL_QUEUE_SIZE if not set.
+	 *
+	 * The queues grow as needed so submission never stalls.
+	 * A larger value would consume more memory upfront but it will avoid
+	 * growing the queues when many async jobs are submitted at once.
+	 */
+	int queue_size;
+
+	/**
+	 * Number of threads that are kept even when they are idle.
+	 *
+	 * Defaults to @ref bio_thread_pool_options_t::num_threads "num_threads" if not set.
+	 * It is always at least 1.
+	 */
+	int min_threads;
+
+	/**
+	 * Maximum number of threads in the thread pool.
+	 *
+	 * Defaults to @ref bio_thread_pool_options_t::num_threads "num_threads" if not set
+	 * so the pool does not grow.
+	 *
+	 * Setting this higher allows the pool to start new threads when all
+	 * of them are occupied, for example, by blocking jobs.
+	 */
+	int max_threads;
+
+	/**
+	 * How long async jobs can wait for a thread before a new one is started.
+	 *
+	 * Defaults to @ref BIO_DEFAULT_THREAD_POOL_SPAWN_DELAY_MS if not set.
+	 */
+	int spawn_delay_ms;
+
+	/**
+	 * How long a thread above @ref bio_thread_pool_options_t::min_threads "min_threads"
+	 * can stay idle before it exits.
+	 *
+	 * Defaults to @ref BIO_DEFAULT_THREAD_POOL_IDLE_TIMEOUT_MS if not set.
+	 */
+	int idle_timeout_ms;
+
+	/**
+	 * The CPUs that the async threads are allowed to run on.
+	 *
+	 * The array is copied during @ref bio_init.
+	 * CPUs which are not available are ignored.
+	 * If none of them are available, the threads keep the affinity they
+	 * inherited.
+	 *
+	 * When this is not set, the threads can run on any CPU which the
+	 * thread calling @ref bio_init could run on before
+	 * @ref bio_options_t::cpus "loop.cpus" was applied.
+	 */
+	const int* cpus;
+
+	/// Number of elements in @ref bio_thread_pool_options_t::cpus "cpus"
+	int num_cpus;
+} bio_thread_pool_options_t;
+
 /**
  * Initialization options
  *
@@ -410,41 +556,183 @@ typedef struct {
 	bio_allocator_t allocator;
 
 	/**
-	 * Number of coroutine-local storage (CLS) hash buckets.
+	 * Initial capacity of the coroutine-local storage (CLS) hash table.
 	 *
 	 * Defaults to @ref BIO_DEFAULT_NUM_CLS_BUCKETS if not provided.
 	 *
-	 * Internally, a hash table is used to keep track of the CLS in each coroutine.
-	 * The buckets are only allocated when a coroutine calls @ref bio_get_cls.
-	 * A larger value will consume more memory but CLS lookup would be faster.
+	 * The first @ref BIO_NUM_INLINE_CLS CLS of a coroutine are stored inline.
+	 * A hash table is only allocated when a coroutine uses more than that.
+	 * It grows as needed.
 	 *
 	 * @see bio_get_cls
 	 */
 	int num_cls_buckets;
 
+	/**
+	 * Scheduler options.
+	 */
+	struct {
+		/**
+		 * Maximum number of coroutine resumes before I/O completions, async
+		 * jobs and timers are checked again.
+		 *
+		 * Normally, the loop runs every ready coroutine before polling for I/O.
+		 * With many busy coroutines, this can delay completions for a long
+		 * time.
+		 * When the budget runs out, the loop polls without waiting then
+		 * continues with the remaining coroutines.
+		 * Coroutines woken up by the poll still run in the next iteration.
+		 *
+		 * @remarks
+		 *   Timers may expire in the middle of an iteration.
+		 *   As a result, a short timer created late in a long iteration may
+		 *   fire after a longer timer created earlier in the same iteration.
+		 *
+		 * Defaults to 0 which only polls once every ready coroutine has run.
+		 */
+		int max_resumes_per_poll;
+
+		/**
+		 * Whether a coroutine woken up by another one runs next.
+		 *
+		 * When a coroutine wakes up another one, for example by sending to a
+		 * @ref mailbox "mailbox" or raising a signal, the woken coroutine
+		 * is placed in a LIFO slot instead of the back of the ready list.
+		 * It runs as soon as the current coroutine suspends, while the data it
+		 * was woken up for is likely still in cache.
+		 * This cuts the latency of request/response pairs such as
+		 * @ref bio_call_service.
+		 *
+		 * Only the most recently woken coroutine is kept in the slot.
+		 * A coroutine never jumps ahead of a higher priority one this way.
+		 *
+		 * Defaults to `false` which keeps the FIFO order of wake ups.
+		 *
+		 * @see max_lifo_runs
+		 */
+		bool lifo_slot;
+
+		/**
+		 * Maximum number of consecutive runs from the LIFO slot.
+		 *
+		 * Coroutines waking each other in a chain could starve the rest.
+		 * After this many consecutive runs, woken coroutines go to the back of
+		 * the ready list again until the next coroutine from the list runs.
+		 *
+		 * Defaults to @ref BIO_DEFAULT_MAX_LIFO_RUNS if not set.
+		 */
+		int max_lifo_runs;
+
+		/**
+		 * Whether to record runtime statistics for each coroutine.
+		 *
+		 * This reads the clock around every resume and wake up so it has a
+		 * small cost.
+		 *
+		 * Defaults to `false`.
+		 *
+		 * @see bio_get_coro_stats
+		 * @see bio_get_coro_stats_by_name
+		 */
+		bool collect_coro_stats;
+	} scheduler;
+
+	/**
+	 * Coroutine pool options.
+	 *
+	 * When a coroutine finishes, its memory and stack are kept so that a
+	 * later @ref bio_spawn_ex with the same @ref bio_coro_options_t::stack_size
+	 * "stack size" can reuse them instead of allocating new ones.
+	 */
+	struct {
+		/**
+		 * Maximum number of finished coroutines kept for each stack size.
+		 *
+		 * Defaults to @ref BIO_DEFAULT_CORO_POOL_SIZE if not set.
+		 * Set to a negative value to disable pooling.
+		 *
+		 * A pooled coroutine keeps the stack memory it has touched so a large
+		 * value increases memory usage after a burst of coroutines.
+		 */
+		int max_idle_coros;
+	} coro_pool;
+
 	/**
 	 * Asynchronous thread pool options.
 	 *
+	 * This pool runs jobs submitted with @ref BIO_ASYNC_COMPUTE.
+	 * Every loop has its own pools so a program running several loops
+	 * starts this many threads for each of them.
+	 *
 	 * @see bio_run_async
 	 */
+	bio_thread_pool_options_t thread_pool;
+
+	/**
+	 * Options for the thread pool running potentially blocking syscalls.
+	 *
+	 * This pool runs jobs submitted with @ref BIO_ASYNC_BLOCKING.
+	 * @ref bio_thread_pool_options_t::num_threads "num_threads" defaults to
+	 * @ref BIO_DEFAULT_BLOCKING_POOL_SIZE and
+	 * @ref bio_thread_pool_options_t::max_threads "max_threads" defaults to
+	 * @ref BIO_DEFAULT_BLOCKING_POOL_MAX_SIZE so this pool grows by default.
+	 *
+	 * @see bio_run_async_ex
+	 */
+	bio_thread_pool_options_t blocking_pool;
+
+	/**
+	 * Options for running multiple loops.
+	 *
+	 * @see bio_current_loop
+	 */
 	struct {
 		/**
-		 * Number of threads in the thread pool.
+		 * The number of @ref bio_spawn_on requests that can be pending for
+		 * this loop.
+		 *
+		 * Defaults to @ref BIO_DEFAULT_LOOP_INBOX_SIZE if not set.
+		 *
+		 * Will be rounded to the nearest power of 2.
+		 * The memory is only allocated when @ref bio_current_loop is first called.
+		 */
+		int inbox_size;
+
+		/**
+		 * Whether this loop takes part in spawn request stealing.
 		 *
-		 * Defaults to @ref BIO_DEFAULT_THREAD_POOL_SIZE if not set.
+		 * When a loop has nothing to run, it takes pending @ref bio_spawn_on
+		 * requests from other participating loops which are busy.
+		 * Requests sent to a participating loop may therefore run on any
+		 * other participating loop.
+		 *
+		 * Only requests which have not started are moved.
+		 * Coroutines which are already running are never rebalanced: a
+		 * coroutine always stays on the loop which created it since its
+		 * handles, signals and timers are local to that loop.
+		 *
+		 * This takes effect when @ref bio_current_loop is first called.
+		 *
+		 * Defaults to `false`.
 		 */
-		int num_threads;
+		bool spawn_stealing;
 
 		/**
-		 * The length of the message queue for each thread in the async thread poo.
+		 * The CPUs that the thread running this loop is allowed to run on.
 		 *
-		 * Defaults to @ref BIO_DEFAULT_THREAD_POOL_QUEUE_SIZE if not set.
+		 * This is applied to the thread calling @ref bio_init and the
+		 * previous affinity is restored by @ref bio_terminate.
+		 * CPUs which are not available are ignored.
+		 * If none of them are available, the affinity of the thread is left
+		 * unchanged.
 		 *
-		 * A larger value would consume more memory upfront but it will allow
-		 * the main thread to submit more async jobs before being stalled.
+		 * When this is not set, the affinity of the thread is not changed.
 		 */
-		int queue_size;
-	} thread_pool;
+		const int* cpus;
+
+		/// Number of elements in @ref bio_options_t::cpus "cpus"
+		int num_cpus;
+	} loop;
 
 	/// Logging options
 	bio_log_options_t log_options;
@@ -512,6 +800,37 @@ typedef enum {
 	BIO_CORO_DEAD,
 } bio_coro_state_t;
 
+/**
+ * Runtime statistics of a coroutine
+ *
+ * @ingroup coro
+ * @see bio_get_coro_stats
+ * @see bio_get_coro_stats_by_name
+ */
+typedef struct {
+	/// Number of times the coroutine was resumed
+	uint64_t num_resumes;
+	/// Total time spent running, in nanoseconds
+	int64_t run_time_ns;
+	/// Total time spent in @ref BIO_CORO_WAITING, in nanoseconds
+	int64_t wait_time_ns;
+} bio_coro_stats_t;
+
+/**
+ * Scheduling priority of a coroutine
+ *
+ * @ingroup coro
+ * @see bio_coro_options_t::priority
+ */
+typedef enum {
+	/// For latency-critical work such as heartbeats and control messages
+	BIO_CORO_PRIORITY_HIGH = -1,
+	/// The default priority
+	BIO_CORO_PRIORITY_NORMAL = 0,
+	/// For bulk work which can wait behind everything else
+	BIO_CORO_PRIORITY_LOW = 1,
+} bio_coro_priority_t;
+
 /**
  * Result for @ref bio_wait_for_exit
  *
@@ -557,6 +876,16 @@ typedef struct {
 	 * so physical memory will only be committed as needed.
 	 */
 	size_t stack_size;
+
+	/**
+	 * Scheduling priority of the coroutine
+	 *
+	 * In each iteration of the loop, all ready coroutines of a higher priority
+	 * are run before those of a lower priority.
+	 *
+	 * Defaults to @ref BIO_CORO_PRIORITY_NORMAL.
+	 */
+	bio_coro_priority_t priority;
 } bio_coro_options_t;
 
 /**
@@ -620,6 +949,8 @@ typedef enum {
 	BIO_ERROR_INVALID_ARGUMENT,
 	/// The operation is not supported
 	BIO_ERROR_NOT_SUPPORTED,
+	/// The operation did not complete within the given timeout
+	BIO_ERROR_TIMED_OUT,
 } bio_core_error_code_t;
 
 /**
@@ -640,6 +971,16 @@ extern const bio_tag_t BIO_CORE_ERROR;
  *
  * @snippet samples/main.c Entrypoint
  *
+ * Every thread that calls @ref bio_init gets its own independent loop.
+ * Each loop has its own coroutines, handles, timers, async thread pool and
+ * platform-specific I/O queue.
+ * Nothing is shared between loops so a handle from one loop is meaningless in
+ * another.
+ * To spread work across CPU cores, start one thread per core, call
+ * @ref bio_init in each of them and use @ref bio_spawn_on to hand work over:
+ *
+ * @snippet samples/loops.c Multiple loops
+ *
  * @{
  */
 
@@ -675,6 +1016,41 @@ bio_terminate(void);
 bool
 bio_is_terminating(void);
 
+/**
+ * Get a reference to the loop of the calling thread
+ *
+ * The reference can be passed to other threads so that they can call
+ * @ref bio_spawn_on.
+ * It stays valid after the loop terminates and must be released with
+ * @ref bio_release_loop once no thread needs it anymore.
+ * Every call returns a new reference which must be released separately.
+ *
+ * The first call to this function allocates the queue for incoming requests.
+ * From then on, the loop will always be ready to be woken up by other threads.
+ *
+ * @remarks
+ *   As with single-loop programs, @ref bio_loop returns as soon as there is
+ *   no more non-daemon coroutines.
+ *   A loop that is only meant to serve requests from other loops should keep
+ *   a coroutine waiting until it is told to stop.
+ *
+ * @see bio_spawn_on
+ * @see bio_release_loop
+ */
+bio_loop_t
+bio_current_loop(void);
+
+/**
+ * Release a reference returned by @ref bio_current_loop
+ *
+ * This can be called from any thread.
+ * @p loop must not be used afterwards.
+ *
+ * @see bio_current_loop
+ */
+void
+bio_release_loop(bio_loop_t loop);
+
 /**@}*/
 
 /**
@@ -732,6 +1108,45 @@ bio_spawn(bio_entrypoint_t entrypoint, void* userdata) {
 	return bio_spawn_ex(entrypoint, userdata, NULL);
 }
 
+/**
+ * Spawn a new coroutine in a different loop.
+ *
+ * This can be called from any thread, including threads that never called
+ * @ref bio_init.
+ * The coroutine is created by the thread running @p loop the next time it
+ * wakes up.
+ * Since handles are local to each loop, no coroutine handle is returned.
+ * Any data needed by the new coroutine must be passed through @p userdata and
+ * must remain valid until the coroutine takes ownership of it.
+ *
+ * If @p loop is the calling thread's own loop, this is the same as
+ * @ref bio_spawn_ex.
+ *
+ * If @p loop has @ref bio_options_t::spawn_stealing "spawn stealing" enabled,
+ * the coroutine may be created in a different participating loop instead.
+ *
+ * @param loop The target loop.
+ *   This must be a reference which has not been released yet.
+ *   Requests that are still pending when the target loop terminates are
+ *   discarded.
+ * @param entrypoint The entrypoint for the coroutine.
+ * @param userdata Data to pass to the entrypoint.
+ * @param options Option for the new coroutine, can be `NULL`.
+ *   This is copied so it does not have to outlive the call.
+ * @return `false` if the request queue of @p loop is full, @p loop has
+ *   terminated or @p loop is invalid.
+ *
+ * @see bio_current_loop
+ * @see bio_options_t::loop
+ */
+bool
+bio_spawn_on(
+	bio_loop_t loop,
+	bio_entrypoint_t entrypoint,
+	void* userdata,
+	const bio_coro_options_t* options
+);
+
 /// Check the state of a coroutine
 bio_coro_state_t
 bio_coro_state(bio_coro_t coro);
@@ -823,6 +1238,42 @@ bio_raise_signal(bio_signal_t signal);
 void
 bio_raise_signal_after(bio_signal_t signal, bio_time_t time_ms);
 
+/**
+ * Raise a signal after a delay in microseconds
+ *
+ * Timers have a resolution of 1 microsecond.
+ * How closely that is followed depends on the platform: Windows can only wait
+ * in milliseconds.
+ *
+ * @param signal The signal to raise
+ * @param time_us The delay in microseconds to raise this signal
+ *
+ * @see bio_raise_signal_after
+ */
+void
+bio_raise_signal_after_us(bio_signal_t signal, bio_time_t time_us);
+
+/**
+ * Raise a signal after a delay which may be extended to save wake ups
+ *
+ * The signal is raised between @p time_us and `time_us + slack_us`
+ * microseconds from now.
+ * Within that window, a time aligned to a coarse boundary is picked.
+ * Timers whose windows overlap tend to be aligned to the same time so the loop
+ * only has to wake up once for all of them.
+ *
+ * This is useful for timeouts which do not need to be precise such as
+ * keepalives and idle timeouts.
+ *
+ * @param signal The signal to raise
+ * @param time_us The minimum delay in microseconds
+ * @param slack_us How late the signal can be raised, in microseconds
+ *
+ * @see bio_raise_signal_after_us
+ */
+void
+bio_raise_signal_after_ex(bio_signal_t signal, bio_time_t time_us, bio_time_t slack_us);
+
 /**
  * Check whether a signal has been raised
  *
@@ -884,6 +1335,81 @@ bio_wait_for_one_signal(bio_signal_t signal) {
 
 /**@}*/
 
+/**
+ * @defgroup wait_group Wait group
+ *
+ * Wait for a group of tasks to complete
+ *
+ * A wait group is a counter.
+ * Tasks are added to it with @ref bio_wait_group_add and marked as completed
+ * with @ref bio_wait_group_done.
+ * @ref bio_wait_group_wait suspends the calling coroutine until the counter
+ * drops to zero.
+ *
+ * Unlike waiting on one signal per task, the cost of marking a task as
+ * completed and of waking the waiters does not depend on the number of tasks.
+ *
+ * @code{.c}
+ * bio_wait_group_t group = bio_make_wait_group();
+ * for (int i = 0; i < num_requests; ++i) {
+ *     bio_wait_group_add(group, 1);
+ *     // The child calls bio_wait_group_done(group) when it is done
+ *     bio_spawn(handle_request, &(request_ctx_t){ .group = group, ... });
+ * }
+ * bio_join(group);
+ * bio_close_wait_group(group);
+ * @endcode
+ *
+ * @{
+ */
+
+/**
+ * Create a new wait group with a counter of zero
+ *
+ * Any coroutine can use or close it.
+ */
+bio_wait_group_t
+bio_make_wait_group(void);
+
+/**
+ * Close a wait group
+ *
+ * All coroutines waiting on it are resumed.
+ */
+void
+bio_close_wait_group(bio_wait_group_t group);
+
+/**
+ * Add to the counter of a wait group
+ *
+ * @param group The wait group
+ * @param delta The number to add, it can be negative.
+ *   The counter does not go below zero.
+ *   When it reaches zero, all waiting coroutines are resumed.
+ */
+void
+bio_wait_group_add(bio_wait_group_t group, int delta);
+
+/// Mark a task in a wait group as completed, equivalent to adding -1
+static inline void
+bio_wait_group_done(bio_wait_group_t group) {
+	bio_wait_group_add(group, -1);
+}
+
+/**
+ * Wait until the counter of a wait group reaches zero
+ *
+ * This returns immediately if the counter is already zero or the group is
+ * invalid.
+ * It also returns when the group is closed.
+ *
+ * Several coroutines can wait on the same group.
+ */
+void
+bio_wait_group_wait(bio_wait_group_t group);
+
+/**@}*/
+
 /**
  * @defgroup monitor Monitor
  *
@@ -942,14 +1468,29 @@ bio_unmonitor(bio_monitor_t monitor);
  * This makes use of @ref bio_monitor to wait for the targeted coroutine.
  *
  * @see bio_monitor
+ * @see bio_join
  */
 static inline void
-bio_join(bio_coro_t coro) {
+bio_join_coro(bio_coro_t coro) {
 	bio_signal_t term_signal = bio_make_signal();
 	bio_monitor(coro, term_signal);
 	bio_wait_for_one_signal(term_signal);
 }
 
+/**
+ * Wait for a coroutine to terminate or for a wait group to reach zero
+ *
+ * @param TARGET Either a @ref bio_coro_t or a @ref bio_wait_group_t
+ *
+ * @see bio_join_coro
+ * @see bio_wait_group_wait
+ */
+#define bio_join(TARGET) \
+	_Generic((TARGET), \
+		bio_coro_t: bio_join_coro, \
+		bio_wait_group_t: bio_wait_group_wait \
+	)(TARGET)
+
 /**@}*/
 
 /**
@@ -1029,6 +1570,37 @@ bio_set_coro_name(const char* name);
 const char*
 bio_get_coro_name(bio_coro_t coro);
 
+/**
+ * Get the runtime statistics of a coroutine
+ *
+ * @param coro The coroutine to query.
+ * @param stats Where to write the statistics.
+ * @return `false` if @p coro is dead or
+ *   @ref bio_options_t::collect_coro_stats "statistics collection" is disabled.
+ *
+ * @see bio_get_coro_stats_by_name
+ */
+bool
+bio_get_coro_stats(bio_coro_t coro, bio_coro_stats_t* stats);
+
+/**
+ * Get the combined runtime statistics of all coroutines with a given name
+ *
+ * This includes coroutines which have already terminated.
+ * Only the activity after a coroutine called @ref bio_set_coro_name is
+ * counted.
+ * Names are compared by content, not by pointer.
+ *
+ * @param name The name given through @ref bio_set_coro_name.
+ * @param stats Where to write the statistics.
+ * @return `false` if no coroutine was ever given this name or
+ *   @ref bio_options_t::collect_coro_stats "statistics collection" is disabled.
+ *
+ * @see bio_get_coro_stats
+ */
+bool
+bio_get_coro_stats_by_name(const char* name, bio_coro_stats_t* stats);
+
 /**
  * Get a coroutine-local storage (CLS) object.
  *
@@ -1155,6 +1727,26 @@ bio_make_handle(void* obj, const bio_tag_t* tag);
 void*
 bio_resolve_handle(bio_handle_t handle, const bio_tag_t* tag);
 
+/**
+ * Resolve many handles of the same type at once
+ *
+ * This is equivalent to calling @ref bio_resolve_handle on each handle but
+ * it is faster for a large number of handles since the lookups can overlap.
+ *
+ * @param handles The handles to resolve
+ * @param num_handles The number of handles
+ * @param tag The "type" tag for all the handles
+ * @param objs Receives the associated pointer of each handle, `NULL` for an
+ *   invalid handle
+ */
+void
+bio_resolve_handles(
+	const bio_handle_t* handles,
+	int num_handles,
+	const bio_tag_t* tag,
+	void** objs
+);
+
 /**
  * Close a handle and invalidate it
  *
@@ -1345,15 +1937,16 @@ bio_clear_error(bio_error_t* error) {
  * When lengthy or potentially blocking work needs to be performed, this should
  * be used to avoid blocking the main thread.
  *
- * The number of async thread is configured through @ref bio_options_t::num_threads.
+ * The number of async thread is configured through @ref bio_thread_pool_options_t::num_threads.
  * More threads will allow more tasks to be executed in parallel.
  *
- * Each thread has a queue whose size is configured through @ref bio_options_t::queue_size.
- * A larger queue size will allow more tasks to be pending.
+ * Each thread has a queue whose initial size is configured through @ref bio_thread_pool_options_t::queue_size.
+ * The queues grow as needed so this function never blocks.
  *
- * bio will always try to load balance the thread pool and send a new task to the least loaded thread.
- * However, when all queues are full, the calling coroutine will enter a busy wait loop.
- * This is done using @ref bio_yield so other coroutines still get to run.
+ * Tasks are distributed to the threads in a round robin fashion.
+ * A thread which runs out of tasks will steal from the others so a long task
+ * does not hold up the ones queued behind it.
+ * Idle threads sleep until new tasks are submitted.
  *
  * Internally, bio also uses the async thread pool to convert a potentially
  * blocking syscall to an asynchronous one when there is no async equivalence
@@ -1367,16 +1960,114 @@ bio_clear_error(bio_error_t* error) {
  *   execution
  *
  * @see bio_run_async_and_wait
+ * @see bio_run_async_job
+ * @see bio_run_async_ex
  */
 void
 bio_run_async(bio_entrypoint_t task, void* userdata, bio_signal_t signal);
 
+/**
+ * Run a function in the given async thread pool
+ *
+ * This is the same as @ref bio_run_async but the pool can be chosen.
+ * Jobs which may block in a syscall should use @ref BIO_ASYNC_BLOCKING so that
+ * they do not occupy the threads for CPU-bound work.
+ *
+ * @param task Entrypoint of the function
+ * @param userdata Arbitrary userdata passed to the function
+ * @param signal The signal that will be raised when @p task finishes
+ *   execution
+ * @param pool The pool to run the function in
+ */
+void
+bio_run_async_ex(
+	bio_entrypoint_t task,
+	void* userdata,
+	bio_signal_t signal,
+	bio_async_pool_t pool
+);
+
+/**
+ * Run a job in the async thread pool using caller-provided storage
+ *
+ * This is the same as @ref bio_run_async but no memory is allocated for the
+ * job.
+ * The storage can simply be a local variable of the calling coroutine, next
+ * to the userdata of the job.
+ *
+ * @param job The job to run.
+ *   Only @ref bio_async_job_t::fn "fn", @ref bio_async_job_t::userdata "userdata"
+ *   and @ref bio_async_job_t::signal "signal" need to be set.
+ *   It must remain valid and unmodified until its signal is raised.
+ *
+ * @see bio_run_async
+ */
+void
+bio_run_async_job(bio_async_job_t* job);
+
+/**
+ * Run a batch of jobs in the async thread pool
+ *
+ * All jobs are queued at once and idle threads will share them.
+ * Only a single signal is raised when the whole batch finishes.
+ *
+ * @param jobs An array of jobs.
+ *   Only @ref bio_async_job_t::fn "fn" and
+ *   @ref bio_async_job_t::userdata "userdata" need to be set, the signal of
+ *   each job is ignored.
+ *   The whole batch runs in the @ref bio_async_job_t::pool "pool" of the
+ *   first job.
+ *   The array must remain valid and unmodified until @p signal is raised.
+ * @param num_jobs Number of jobs in the array
+ * @param signal The signal that will be raised when all jobs finish
+ *
+ * @see bio_parallel_for
+ */
+void
+bio_run_async_batch(bio_async_job_t* jobs, int num_jobs, bio_signal_t signal);
+
+/**
+ * Split a range into chunks and process them in the async thread pool
+ *
+ * The chunks run in the @ref BIO_ASYNC_COMPUTE pool.
+ * The calling coroutine is suspended until all chunks are processed.
+ *
+ * @param begin Start of the range
+ * @param end End of the range (exclusive)
+ * @param grain Maximum number of elements in a chunk.
+ *   When this is 0, the range is split evenly between the threads.
+ * @param fn The function to process a chunk.
+ *   It will be called from multiple threads at the same time.
+ * @param userdata Arbitrary userdata passed to @p fn
+ *
+ * @see bio_run_async_batch
+ */
+void
+bio_parallel_for(
+	size_t begin,
+	size_t end,
+	size_t grain,
+	bio_range_fn_t fn,
+	void* userdata
+);
+
+/// Start an async task in the given pool and wait for it to complete.
+static inline void
+bio_run_async_and_wait_ex(bio_entrypoint_t task, void* userdata, bio_async_pool_t pool) {
+	bio_async_job_t job = {
+		.fn = task,
+		.userdata = userdata,
+		.signal = bio_make_signal(),
+		.pool = pool,
+	};
+	bio_run_async_job(&job);
+	bio_wait_for_one_signal(job.signal);
+}
+
 /// Convenient function to start an async task and wait for it to complete.
 static inline void
 bio_run_async_and_wait(bio_entrypoint_t task, void* userdata) {
-	bio_signal_t signal = bio_make_signal();
-	bio_run_async(task, userdata, signal);
-	bio_wait_for_one_signal(signal);
+	bio_run_async_and_wait_ex(task, userdata, BIO_ASYNC_COMPUTE);
 }
 
 /**
@@ -1389,6 +2080,36 @@ bio_run_async_and_wait(bio_entrypoint_t task, void* userdata) {
 bio_time_t
 bio_current_time_ms(void);
 
+/**
+ * Return the current time in microseconds
+ *
+ * This uses the same clock as @ref bio_current_time_ms.
+ */
+bio_time_t
+bio_current_time_us(void);
+
+/**
+ * Return the time at the start of the current loop iteration in milliseconds
+ *
+ * Unlike @ref bio_current_time_ms, this does not query the OS.
+ * It is the time which delays given to @ref bio_raise_signal_after are
+ * relative to.
+ * The value does not change while coroutines are running so it is only
+ * suitable for coarse timestamps.
+ *
+ * @see bio_loop_time_us
+ */
+bio_time_t
+bio_loop_time_ms(void);
+
+/**
+ * Return the time at the start of the current loop iteration in microseconds
+ *
+ * @see bio_loop_time_ms
+ */
+bio_time_t
+bio_loop_time_us(void);
+
 /**
  * Wait for an exit signal to be delivered by the OS
  *
@@ -122,6 +122,31 @@ bio_fread(
 	bio_error_t* error
 );
 
+/**
+ * Read from a file with a timeout.
+ *
+ * This is mostly useful for pipes and terminals where a read can block
+ * indefinitely.
+ *
+ * @param timeout_ms Timeout in milliseconds.
+ *   A non-positive value waits indefinitely.
+ *   Timeouts are currently only implemented on Linux.
+ *   On other platforms, a positive value fails immediately with
+ *   @ref BIO_ERROR_NOT_SUPPORTED.
+ *
+ * If nothing was read in time, @p error is set to @ref BIO_ERROR_TIMED_OUT.
+ *
+ * @see bio_fread
+ */
+size_t
+bio_fread_ex(
+	bio_file_t file,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+);
+
 /**
  * Modify the file offset
  *
@@ -192,6 +192,28 @@ bio_net_accept(
 	bio_error_t* error
 );
 
+/**
+ * Accept a new connection with a timeout
+ *
+ * @param timeout_ms Timeout in milliseconds.
+ *   A non-positive value waits indefinitely.
+ *   Timeouts are currently only implemented on Linux.
+ *   On other platforms, a positive value fails immediately with
+ *   @ref BIO_ERROR_NOT_SUPPORTED.
+ *
+ * If no connection arrives in time, @p error is set to
+ * @ref BIO_ERROR_TIMED_OUT.
+ *
+ * @see bio_net_accept
+ */
+bool
+bio_net_accept_ex(
+	bio_socket_t socket,
+	bio_socket_t* client,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+);
+
 /**
  * Make an outgoing connection
  *
@@ -213,6 +235,30 @@ bio_net_connect(
 	bio_error_t* error
 );
 
+/**
+ * Make an outgoing connection with a timeout
+ *
+ * @param timeout_ms Timeout in milliseconds.
+ *   A non-positive value waits indefinitely.
+ *   Timeouts are currently only implemented on Linux.
+ *   On other platforms, a positive value fails immediately with
+ *   @ref BIO_ERROR_NOT_SUPPORTED.
+ *
+ * If the connection is not established in time, @p error is set to
+ * @ref BIO_ERROR_TIMED_OUT.
+ *
+ * @see bio_net_connect
+ */
+bool
+bio_net_connect_ex(
+	bio_socket_type_t socket_type,
+	const bio_addr_t* addr,
+	bio_port_t port,
+	bio_socket_t* socket,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+);
+
 /// Close a socket
 bool
 bio_net_close(bio_socket_t socket, bio_error_t* error);
@@ -232,6 +278,29 @@ bio_net_send(
 	bio_error_t* error
 );
 
+/**
+ * Send to a socket with a timeout
+ *
+ * @param timeout_ms Timeout in milliseconds.
+ *   A non-positive value waits indefinitely.
+ *   Timeouts are currently only implemented on Linux.
+ *   On other platforms, a positive value fails immediately with
+ *   @ref BIO_ERROR_NOT_SUPPORTED.
+ *
+ * If nothing could be sent in time, @p error is set to
+ * @ref BIO_ERROR_TIMED_OUT.
+ *
+ * @see bio_net_send
+ */
+size_t
+bio_net_send_ex(
+	bio_socket_t socket,
+	const void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+);
+
 /**
  * Receive from a socket
  *
@@ -247,6 +316,29 @@ bio_net_recv(
 	bio_error_t* error
 );
 
+/**
+ * Receive from a socket with a timeout
+ *
+ * @param timeout_ms Timeout in milliseconds.
+ *   A non-positive value waits indefinitely.
+ *   Timeouts are currently only implemented on Linux.
+ *   On other platforms, a positive value fails immediately with
+ *   @ref BIO_ERROR_NOT_SUPPORTED.
+ *
+ * If nothing was received in time, @p error is set to
+ * @ref BIO_ERROR_TIMED_OUT.
+ *
+ * @see bio_net_recv
+ */
+size_t
+bio_net_recv_ex(
+	bio_socket_t socket,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+);
+
 /// Not implemented
 size_t
 bio_net_sendto(
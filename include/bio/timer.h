@@ -26,10 +26,18 @@ typedef enum {
  * Create a new timer
  *
  * @remarks
- *   A timer is implemented as a coroutine waiting on its own (delayed) signal.
+ *   Timers are kept in a hierarchical timing wheel with a resolution of 1us.
+ *   Creating, resetting and cancelling a timer take constant time.
+ *   @p fn is called directly from the loop, outside of any coroutine.
+ *   It must not block.
+ *   To do I/O, spawn a coroutine from it.
+ *
+ * @remarks
+ *   A pending timer keeps @ref bio_loop running.
  *   When a timer of type @ref BIO_TIMER_INTERVAL is no longer needed, it should
  *   be cancelled with @ref bio_cancel_timer.
  *   Otherwise, @ref bio_loop will never terminate.
+ *   Timers still pending in @ref bio_terminate are discarded.
  *
  * @param type The type of timer
  * @param timeout_ms The period or the delay for the timer in milliseconds
@@ -44,6 +52,36 @@ bio_create_timer(
 	bio_entrypoint_t fn, void* userdata
 );
 
+/**
+ * Create a new timer with a period or delay in microseconds
+ *
+ * @see bio_create_timer
+ */
+bio_timer_t
+bio_create_timer_us(
+	bio_timer_type_t type,
+	bio_time_t timeout_us,
+	bio_entrypoint_t fn, void* userdata
+);
+
+/**
+ * Create a new timer which may fire late to save wake ups
+ *
+ * Every time the timer is armed, it fires between @p timeout_us and
+ * `timeout_us + slack_us` microseconds later.
+ * The slack also applies when the timer is reset.
+ *
+ * @see bio_create_timer
+ * @see bio_raise_signal_after_ex
+ */
+bio_timer_t
+bio_create_timer_ex(
+	bio_timer_type_t type,
+	bio_time_t timeout_us,
+	bio_time_t slack_us,
+	bio_entrypoint_t fn, void* userdata
+);
+
 /**
  * Check whether a timer is pending
  *
@@ -69,6 +107,14 @@ bio_is_timer_pending(bio_timer_t timer);
 void
 bio_reset_timer(bio_timer_t timer, bio_time_t timeout_ms);
 
+/**
+ * Reset a timer with a timeout in microseconds
+ *
+ * @see bio_reset_timer
+ */
+void
+bio_reset_timer_us(bio_timer_t timer, bio_time_t timeout_us);
+
 /**
  * Cancel a timer.
  *
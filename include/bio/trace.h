@@ -0,0 +1,98 @@
+#ifndef BIO_TRACE_H
+#define BIO_TRACE_H
+
+#include "file.h"
+
+/**
+ * @defgroup trace Tracing
+ *
+ * Record a timeline of scheduler and I/O events.
+ *
+ * While tracing is active, the following events are recorded:
+ *
+ * * A coroutine being resumed and suspended, along with the reason: yielding,
+ *   waiting for signals or exiting.
+ * * A coroutine being woken up by a raised signal.
+ * * An I/O request being submitted and completed.
+ *
+ * Events are stored in a fixed-size in-memory ring and periodically written
+ * to a file in the Chrome trace event JSON format.
+ * The file can be opened in `chrome://tracing` or https://ui.perfetto.dev.
+ * Each coroutine is shown as a separate track.
+ *
+ * @code{.c}
+ * bio_file_t trace_file;
+ * bio_fopen(&trace_file, "trace.json", "w", NULL);
+ * bio_start_trace(&(bio_trace_options_t){ .file = trace_file });
+ *
+ * // ...
+ *
+ * bio_stop_trace();
+ * bio_fclose(trace_file, NULL);
+ * @endcode
+ *
+ * @{
+ */
+
+/// Configuration options
+typedef struct {
+	/**
+	 * The file to write to
+	 *
+	 * It must stay open until @ref bio_stop_trace returns.
+	 */
+	bio_file_t file;
+
+	/**
+	 * Number of events that can be buffered between two flushes.
+	 *
+	 * When the ring is full, new events are dropped.
+	 *
+	 * Defaults to @ref BIO_DEFAULT_TRACE_RING_SIZE if not set.
+	 * It will be rounded up to the next power of 2.
+	 */
+	int ring_size;
+
+	/**
+	 * How often the ring is flushed to the file, in milliseconds.
+	 *
+	 * Defaults to @ref BIO_DEFAULT_TRACE_FLUSH_INTERVAL_MS if not set.
+	 */
+	bio_time_t flush_interval_ms;
+} bio_trace_options_t;
+
+/**
+ * Start tracing the current loop
+ *
+ * This spawns a daemon coroutine which periodically flushes the recorded
+ * events.
+ * The events are formatted in the @ref bio_run_async "async thread pool" so
+ * the loop only pays for recording them.
+ *
+ * @return `false` if tracing was already started
+ *
+ * @see bio_stop_trace
+ */
+bool
+bio_start_trace(const bio_trace_options_t* options);
+
+/**
+ * Stop tracing and flush all recorded events
+ *
+ * When called from a coroutine, this waits until the trace file is complete.
+ * Otherwise, the trace is completed in the background.
+ *
+ * Tracing is also stopped by @ref bio_terminate.
+ */
+void
+bio_stop_trace(void);
+
+/**
+ * Check whether tracing is active
+ */
+bool
+bio_is_tracing(void);
+
+/**@}*/
+
+#endif
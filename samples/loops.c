@@ -0,0 +1,41 @@
+#include <bio/bio.h>
+#include <threads.h>
+
+//! [Multiple loops]
+typedef struct {
+	bio_loop_t loop;
+	bio_signal_t stop;
+	// Other synchronization is omitted for brevity
+} worker_t;
+
+static void
+keep_alive(void* userdata) {
+	worker_t* worker = userdata;
+	worker->stop = bio_make_signal();
+	worker->loop = bio_current_loop();
+	// Keep the loop running until told to stop
+	bio_wait_for_one_signal(worker->stop);
+}
+
+static int
+worker_main(void* userdata) {
+	// Each thread has its own loop
+	bio_init(NULL);
+	bio_spawn(keep_alive, userdata);
+	bio_loop();
+	bio_terminate();
+	return 0;
+}
+
+static void
+main_coro(void* userdata) {
+	worker_t* workers = userdata;
+	// Once the workers are ready, hand over work to them
+	for (int i = 0; i < NUM_WORKERS; ++i) {
+		bio_spawn_on(workers[i].loop, handle_request, &requests[i], NULL);
+		// The reference stays valid until it is released, even if the
+		// worker has already terminated
+		bio_release_loop(workers[i].loop);
+	}
+}
+//! [Multiple loops]
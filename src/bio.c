@@ -3,7 +3,7 @@
 #include <minicoro.h>
 #include <string.h>
 
-bio_ctx_t bio_ctx = { 0 };
+BIO_THREAD_LOCAL bio_ctx_t bio_ctx = { 0 };
 
 const bio_tag_t BIO_CORE_ERROR = BIO_TAG_INIT("bio.error.core");
 
@@ -27,6 +27,8 @@ bio_core_strerror(int code) {
 			return "Invalid argument";
 		case BIO_ERROR_NOT_SUPPORTED:
 			return "Operation is not supported";
+		case BIO_ERROR_TIMED_OUT:
+			return "Operation timed out";
 	}
 
 	return "Unknown error";
@@ -76,8 +78,9 @@ bio_terminate(void) {
 
 	bio_dispatch_exit_signal(BIO_EXIT_TERMINATE);
 
-	// Logging uses daemon coroutines
+	// Logging and tracing use daemon coroutines
 	bio_logging_cleanup();
+	bio_trace_cleanup();
 	if (bio_ctx.num_daemons > 0) { bio_loop(); }
 
 	bio_net_cleanup();
@@ -100,6 +103,21 @@ bio_current_time_ms(void) {
 	return bio_platform_current_time_ms();
 }
 
+bio_time_t
+bio_current_time_us(void) {
+	return bio_platform_current_time_ns() / 1000;
+}
+
+bio_time_t
+bio_loop_time_ms(void) {
+	return bio_ctx.current_time_us / 1000;
+}
+
+bio_time_t
+bio_loop_time_us(void) {
+	return bio_ctx.current_time_us;
+}
+
 bio_exit_reason_t
 bio_wait_for_exit(void) {
 	mco_coro* impl = mco_running();
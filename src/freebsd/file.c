@@ -29,7 +29,7 @@ typedef struct {
 
 static bio_file_t
 bio_file_from_fd(int fd, int64_t offset, bool seekable) {
-	bio_file_impl_t* file_impl = bio_malloc(sizeof(bio_file_impl_t));
+	bio_file_impl_t* file_impl = bio_slab_alloc(&bio_ctx.file_slab);
 	*file_impl = (bio_file_impl_t){
 		.fd = fd,
 		.offset = seekable ? offset : 0,
@@ -42,6 +42,8 @@ bio_file_from_fd(int fd, int64_t offset, bool seekable) {
 
 void
 bio_fs_init(void) {
+	bio_slab_init(&bio_ctx.file_slab, sizeof(bio_file_impl_t));
+
 	BIO_STDIN = bio_file_from_fd(0, 0, false);
 	BIO_STDOUT = bio_file_from_fd(1, 0, false);
 	BIO_STDERR = bio_file_from_fd(2, 0, false);
@@ -49,9 +51,11 @@ bio_fs_init(void) {
 
 void
 bio_fs_cleanup(void) {
-	bio_free(bio_close_handle(BIO_STDIN.handle, &BIO_FILE_HANDLE));
-	bio_free(bio_close_handle(BIO_STDOUT.handle, &BIO_FILE_HANDLE));
-	bio_free(bio_close_handle(BIO_STDERR.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDIN.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDOUT.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDERR.handle, &BIO_FILE_HANDLE));
+
+	bio_slab_cleanup(&bio_ctx.file_slab);
 }
 
 bool
@@ -128,7 +132,7 @@ bio_fopen(
 		.filename = filename,
 		.flags = flags | O_CLOEXEC | O_NONBLOCK,
 	};
-	bio_run_async_and_wait(bio_fs_fopen, &args);
+	bio_run_async_and_wait_ex(bio_fs_fopen, &args, BIO_ASYNC_BLOCKING);
 	if (args.result >= 0) {
 		*file_ptr = bio_file_from_fd(args.result, args.offset, args.offset >= 0);
 		return true;
@@ -150,7 +154,7 @@ bio_fclose(bio_file_t file, bio_error_t* error) {
 			bio_set_errno(error, EBUSY);
 			return false;
 		} else {
-			bio_free(impl);
+			bio_slab_free(&bio_ctx.file_slab, impl);
 			int result = close(fd);
 			if (result == 0) {
 				return true;
@@ -266,7 +270,7 @@ bio_fwrite_in_async_thread(
 		.buf = (void*)buf,
 		.size = size,
 	};
-	bio_run_async_and_wait(bio_fs_write, &args);
+	bio_run_async_and_wait_ex(bio_fs_write, &args, BIO_ASYNC_BLOCKING);
 	if (args.result >= 0) {
 		return (size_t)args.result;
 	} else {
@@ -287,7 +291,7 @@ bio_fread_in_async_thread(
 		.buf = buf,
 		.size = size,
 	};
-	bio_run_async_and_wait(bio_fs_read, &args);
+	bio_run_async_and_wait_ex(bio_fs_read, &args, BIO_ASYNC_BLOCKING);
 	if (args.result >= 0) {
 		return (size_t)args.result;
 	} else {
@@ -299,7 +303,7 @@ bio_fread_in_async_thread(
 static bool
 bio_fsync_in_async_thread(bio_file_impl_t* impl, bio_error_t* error) {
 	bio_fs_io_args_t args = { .fd = impl->fd };
-	bio_run_async_and_wait(bio_fs_fsync, &args);
+	bio_run_async_and_wait_ex(bio_fs_fsync, &args, BIO_ASYNC_BLOCKING);
 	if (args.result >= 0) {
 		return true;
 	} else {
@@ -593,7 +597,7 @@ bio_fstat(bio_file_t file, bio_stat_t* stat, bio_error_t* error) {
 			.fd = impl->fd,
 			.stat = &fstat,
 		};
-		bio_run_async_and_wait(bio_fs_fstat, &args);
+		bio_run_async_and_wait_ex(bio_fs_fstat, &args, BIO_ASYNC_BLOCKING);
 		if (args.result == 0) {
 			stat->size = (size_t)fstat.st_size;
 			return true;
@@ -606,3 +610,20 @@ bio_fstat(bio_file_t file, bio_stat_t* stat, bio_error_t* error) {
 		return false;
 	}
 }
+
+size_t
+bio_fread_ex(
+	bio_file_t file,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	// Per-operation timeouts are only implemented with io_uring linked timeouts
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return 0;
+	}
+
+	return bio_fread(file, buf, size, error);
+}
@@ -138,7 +138,7 @@ bio_make_socket(
 
 static bio_socket_t
 bio_socket_from_fd(int fd) {
-	bio_socket_impl_t* sock_impl = bio_malloc(sizeof(bio_socket_impl_t));
+	bio_socket_impl_t* sock_impl = bio_slab_alloc(&bio_ctx.socket_slab);
 	*sock_impl = (bio_socket_impl_t){ .fd = fd };
 	return (bio_socket_t){
 		.handle = bio_make_handle(sock_impl, &BIO_SOCKET_HANDLE),
@@ -203,10 +203,12 @@ bio_net_wait_for_write(bio_socket_t ref, bio_socket_impl_t* impl) {
 
 void
 bio_net_init(void) {
+	bio_slab_init(&bio_ctx.socket_slab, sizeof(bio_socket_impl_t));
 }
 
 void
 bio_net_cleanup(void) {
+	bio_slab_cleanup(&bio_ctx.socket_slab);
 }
 
 bool
@@ -441,7 +443,7 @@ bio_net_close(bio_socket_t socket, bio_error_t* error) {
 		}
 
 		int fd = impl->fd;
-		bio_free(impl);
+		bio_slab_free(&bio_ctx.socket_slab, impl);
 
 		int result = close(fd);
 		if (result == 0) {
@@ -455,3 +457,69 @@ bio_net_close(bio_socket_t socket, bio_error_t* error) {
 		return false;
 	}
 }
+
+// Per-operation timeouts are only implemented with io_uring linked timeouts
+
+bool
+bio_net_accept_ex(
+	bio_socket_t socket,
+	bio_socket_t* client,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return false;
+	}
+
+	return bio_net_accept(socket, client, error);
+}
+
+bool
+bio_net_connect_ex(
+	bio_socket_type_t socket_type,
+	const bio_addr_t* addr,
+	bio_port_t port,
+	bio_socket_t* sock,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return false;
+	}
+
+	return bio_net_connect(socket_type, addr, port, sock, error);
+}
+
+size_t
+bio_net_send_ex(
+	bio_socket_t socket,
+	const void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return 0;
+	}
+
+	return bio_net_send(socket, buf, size, error);
+}
+
+size_t
+bio_net_recv_ex(
+	bio_socket_t socket,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return 0;
+	}
+
+	return bio_net_recv(socket, buf, size, error);
+}
@@ -1,10 +1,15 @@
 #include "common.h"
 #include <sys/event.h>
+#include <sys/types.h>
+#include <sys/umtx.h>
+#include <sys/param.h>
+#include <sys/cpuset.h>
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
 #include <signal.h>
 #include <string.h>
+#include <errno.h>
 
 static const bio_tag_t BIO_PLATFORM_ERROR = BIO_TAG_INIT("bio.error.freebsd");
 
@@ -55,10 +60,10 @@ bio_platform_dispatch_events(struct kevent* events, int num_events) {
 }
 
 void
-bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
+bio_platform_update(bio_time_t wait_timeout_us, bool notifiable) {
 	struct timespec timespec = {
-		.tv_sec = wait_timeout_ms / 1000,
-		.tv_nsec = (wait_timeout_ms % 1000) * 1000000,
+		.tv_sec = wait_timeout_us / 1000000,
+		.tv_nsec = (wait_timeout_us % 1000000) * 1000,
 	};
 
 	// Filter out cancelled event
@@ -81,7 +86,7 @@ bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
 		bio_ctx.platform.kqueue,
 		bio_ctx.platform.in_events, (int)out_index,
 		bio_ctx.platform.out_events, bio_ctx.options.freebsd.kqueue.batch_size,
-		wait_timeout_ms >= 0 ? &timespec : NULL
+		wait_timeout_us >= 0 ? &timespec : NULL
 	);
 	bio_array_clear(bio_ctx.platform.in_events);
 	bio_platform_dispatch_events(bio_ctx.platform.out_events, num_events);
@@ -99,19 +104,61 @@ bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
 }
 
 void
-bio_platform_notify(void) {
+bio_platform_notify(bio_platform_t* platform) {
 	struct kevent event = {
 		.filter = EVFILT_USER,
 		.fflags = NOTE_FFNOP | NOTE_TRIGGER,
 	};
 	kevent(
-		bio_ctx.platform.kqueue,
+		platform->kqueue,
 		&event, 1,
 		NULL, 0,
 		NULL
 	);
 }
 
+bool
+bio_platform_futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms) {
+	struct timespec timeout = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (long)(timeout_ms % 1000) * 1000000L,
+	};
+	// The size of the timeout is passed in place of the first pointer
+	int result = timeout_ms >= 0
+		? _umtx_op(addr, UMTX_OP_WAIT_UINT_PRIVATE, expected, (void*)(uintptr_t)sizeof(timeout), &timeout)
+		: _umtx_op(addr, UMTX_OP_WAIT_UINT_PRIVATE, expected, NULL, NULL);
+	return !(result < 0 && errno == ETIMEDOUT);
+}
+
+void
+bio_platform_futex_wake(atomic_uint* addr, int count) {
+	_umtx_op(addr, UMTX_OP_WAKE_PRIVATE, count, NULL, NULL);
+}
+
+bool
+bio_platform_set_thread_affinity(const int* cpus, int num_cpus) {
+	cpuset_t set;
+	CPU_ZERO(&set);
+	for (int i = 0; i < num_cpus; ++i) {
+		if (0 <= cpus[i] && cpus[i] < CPU_SETSIZE) { CPU_SET(cpus[i], &set); }
+	}
+	return cpuset_setaffinity(CPU_LEVEL_WHICH, CPU_WHICH_TID, -1, sizeof(set), &set) == 0;
+}
+
+int
+bio_platform_get_thread_affinity(int* cpus, int max_cpus) {
+	cpuset_t set;
+	if (cpuset_getaffinity(CPU_LEVEL_WHICH, CPU_WHICH_TID, -1, sizeof(set), &set) != 0) {
+		return 0;
+	}
+
+	int num_cpus = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE && num_cpus < max_cpus; ++cpu) {
+		if (CPU_ISSET(cpu, &set)) { cpus[num_cpus++] = cpu; }
+	}
+	return num_cpus;
+}
+
 bio_time_t
 bio_platform_current_time_ms(void) {
 	struct timespec timespec;
@@ -119,6 +166,13 @@ bio_platform_current_time_ms(void) {
 	return (timespec.tv_sec * 1000L) + (timespec.tv_nsec / 1000000L);
 }
 
+int64_t
+bio_platform_current_time_ns(void) {
+	struct timespec timespec;
+	clock_gettime(CLOCK_MONOTONIC, &timespec);
+	return (timespec.tv_sec * 1000000000L) + timespec.tv_nsec;
+}
+
 void
 bio_platform_begin_create_thread_pool(void) {
 	// block all signals before creating new threads so only the main thread
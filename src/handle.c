@@ -4,32 +4,56 @@
 
 static inline void
 bio_grow_handle_table(int32_t old_capacity, int32_t new_capacity) {
-	bio_ctx.handle_slots = bio_realloc(
-		bio_ctx.handle_slots,
-		sizeof(bio_handle_slot_t) * new_capacity
+	bio_ctx.handle_metas = bio_realloc(
+		bio_ctx.handle_metas,
+		sizeof(bio_handle_meta_t) * new_capacity
+	);
+	bio_ctx.handle_objs = bio_realloc(
+		bio_ctx.handle_objs,
+		sizeof(void*) * new_capacity
+	);
+	bio_ctx.handle_free_list = bio_realloc(
+		bio_ctx.handle_free_list,
+		sizeof(int32_t) * new_capacity
 	);
 
 	for (int32_t i = old_capacity; i < new_capacity; ++i) {
-		bio_handle_slot_t* slot = &bio_ctx.handle_slots[i];
-		slot->gen = 0;
-		slot->obj = NULL;
-		slot->tag = NULL;
-		slot->next_handle_slot = i + 1;
+		bio_ctx.handle_metas[i] = (bio_handle_meta_t){ .gen = 0 };
+		bio_ctx.handle_objs[i] = NULL;
+		bio_ctx.handle_free_list[i] = i + 1;
 	}
 	bio_ctx.next_handle_slot = old_capacity;
 	bio_ctx.handle_capacity = new_capacity;
 }
 
+static inline bool
+bio_handle_is_valid(bio_handle_t handle, const bio_tag_t* tag, int32_t* index_out) {
+	int32_t index = handle.index - 1;
+	if (BIO_LIKELY(0 <= index && index < bio_ctx.handle_capacity)) {
+		const bio_handle_meta_t* meta = &bio_ctx.handle_metas[index];
+		if (BIO_LIKELY(meta->gen == handle.gen && meta->tag == tag)) {
+			*index_out = index;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void
 bio_handle_table_init(void) {
 	bio_ctx.num_handles = 0;
-	bio_ctx.handle_slots = NULL;
+	bio_ctx.handle_metas = NULL;
+	bio_ctx.handle_objs = NULL;
+	bio_ctx.handle_free_list = NULL;
 	bio_grow_handle_table(0, BIO_INITIAL_HANDLE_CAPACITY);
 }
 
 void
 bio_handle_table_cleanup(void) {
-	bio_free(bio_ctx.handle_slots);
+	bio_free(bio_ctx.handle_free_list);
+	bio_free(bio_ctx.handle_objs);
+	bio_free(bio_ctx.handle_metas);
 }
 
 bio_handle_t
@@ -38,39 +62,63 @@ bio_make_handle(void* obj, const bio_tag_t* tag) {
 		bio_grow_handle_table(bio_ctx.handle_capacity, bio_ctx.handle_capacity * 2);
 	}
 
-	int next_handle_slot = bio_ctx.next_handle_slot;
-	bio_handle_slot_t* slot = &bio_ctx.handle_slots[next_handle_slot];
-	slot->obj = obj;
-	slot->tag = tag;
-	bio_ctx.next_handle_slot = slot->next_handle_slot;
+	int32_t index = bio_ctx.next_handle_slot;
+	bio_handle_meta_t* meta = &bio_ctx.handle_metas[index];
+	meta->tag = tag;
+	bio_ctx.handle_objs[index] = obj;
+	bio_ctx.next_handle_slot = bio_ctx.handle_free_list[index];
 	++bio_ctx.num_handles;
 
 	return (bio_handle_t){
-		.index = next_handle_slot + 1,
-		.gen = slot->gen,
+		.index = index + 1,
+		.gen = meta->gen,
 	};
 }
 
 void*
 bio_resolve_handle(bio_handle_t handle, const bio_tag_t* tag) {
-	int32_t index = handle.index - 1;
-	if (BIO_LIKELY(0 <= index && index < bio_ctx.handle_capacity)) {
-		bio_handle_slot_t* slot = &bio_ctx.handle_slots[index];
-		if (BIO_LIKELY(slot->gen == handle.gen && slot->tag == tag)) {
-			return slot->obj;
+	int32_t index;
+	if (bio_handle_is_valid(handle, tag, &index)) {
+		return bio_ctx.handle_objs[index];
+	} else {
+		return NULL;
+	}
+}
+
+void
+bio_resolve_handles(
+	const bio_handle_t* handles,
+	int num_handles,
+	const bio_tag_t* tag,
+	void** objs
+) {
+#ifdef __GNUC__
+	// Issue all the loads up front so the cache misses overlap instead of
+	// being paid one after another
+	for (int i = 0; i < num_handles; ++i) {
+		int32_t index = handles[i].index - 1;
+		if (0 <= index && index < bio_ctx.handle_capacity) {
+			__builtin_prefetch(&bio_ctx.handle_metas[index]);
+			__builtin_prefetch(&bio_ctx.handle_objs[index]);
 		}
 	}
+#endif
 
-	return NULL;
+	for (int i = 0; i < num_handles; ++i) {
+		int32_t index;
+		objs[i] = bio_handle_is_valid(handles[i], tag, &index)
+			? bio_ctx.handle_objs[index]
+			: NULL;
+	}
 }
 
 const bio_tag_t*
 bio_handle_info(bio_handle_t handle) {
 	int32_t index = handle.index - 1;
 	if (BIO_LIKELY(0 <= index && index < bio_ctx.handle_capacity)) {
-		bio_handle_slot_t* slot = &bio_ctx.handle_slots[index];
-		if (BIO_LIKELY(slot->gen == handle.gen)) {
-			return slot->tag;
+		const bio_handle_meta_t* meta = &bio_ctx.handle_metas[index];
+		if (BIO_LIKELY(meta->gen == handle.gen)) {
+			return meta->tag;
 		}
 	}
 
@@ -79,17 +127,14 @@ bio_handle_info(bio_handle_t handle) {
 
 void*
 bio_close_handle(bio_handle_t handle, const bio_tag_t* tag) {
-	int32_t index = handle.index - 1;
-	if (BIO_LIKELY(0 <= index && index < bio_ctx.handle_capacity)) {
-		bio_handle_slot_t* slot = &bio_ctx.handle_slots[index];
-		if (BIO_LIKELY(slot->gen == handle.gen && slot->tag == tag)) {
-			++slot->gen;
-			slot->next_handle_slot = bio_ctx.next_handle_slot;
-			bio_ctx.next_handle_slot = index;
-			--bio_ctx.num_handles;
-
-			return slot->obj;
-		}
+	int32_t index;
+	if (bio_handle_is_valid(handle, tag, &index)) {
+		++bio_ctx.handle_metas[index].gen;
+		bio_ctx.handle_free_list[index] = bio_ctx.next_handle_slot;
+		bio_ctx.next_handle_slot = index;
+		--bio_ctx.num_handles;
+
+		return bio_ctx.handle_objs[index];
 	}
 
 	return NULL;
@@ -33,30 +33,111 @@
  * The async thread pool is handled through @ref bio_platform_notify.
  * Whenever a task has finished execution, bio will call @ref bio_platform_notify
  * from the **worker thread**, not the main thread.
+ * The same happens when a different loop calls @ref bio_spawn_on.
  * The implementation must have a way to make @ref bio_platform_update return
  * when signalled from a different thread regardless of whether an I/O event
  * has occured.
+ *
+ * The context is thread-local so that every thread calling @ref bio_init runs
+ * its own independent loop.
+ * As a result, @ref bio_platform_notify must not access the context of the
+ * calling thread.
+ * It receives the platform data of the targeted loop instead.
  * Async I/O APIs often have some sort of "user event" that can be
  * posted from another thread for this purpose.
  *
  * @{
  */
 
-/// The default number of CLS hash buckets
+/// The default initial capacity of the CLS table used once the inline slots are full
 #ifndef BIO_DEFAULT_NUM_CLS_BUCKETS
 #	define BIO_DEFAULT_NUM_CLS_BUCKETS 4
 #endif
 
+/// The number of CLS stored directly in a coroutine
+#ifndef BIO_NUM_INLINE_CLS
+#	define BIO_NUM_INLINE_CLS 4
+#endif
+
+/// The number of slab size classes for CLS data.
+/// Class i holds data up to `BIO_MIN_CLS_SLAB_ITEM_SIZE << i` bytes, larger
+/// data is allocated individually.
+#ifndef BIO_NUM_CLS_SLABS
+#	define BIO_NUM_CLS_SLABS 5
+#endif
+
+#define BIO_MIN_CLS_SLAB_ITEM_SIZE 16
+
+/// The default number of finished coroutines kept for reuse, per stack size
+#ifndef BIO_DEFAULT_CORO_POOL_SIZE
+#	define BIO_DEFAULT_CORO_POOL_SIZE 64
+#endif
+
+/// The default number of consecutive runs from the LIFO slot
+#ifndef BIO_DEFAULT_MAX_LIFO_RUNS
+#	define BIO_DEFAULT_MAX_LIFO_RUNS 8
+#endif
+
 /// The default number of threads in the async thread pool
 #ifndef BIO_DEFAULT_THREAD_POOL_SIZE
 #	define BIO_DEFAULT_THREAD_POOL_SIZE 2
 #endif
 
-/// The default queue size for the async thread pool
+/// The default initial capacity of the job queue of each async thread
 #ifndef BIO_DEFAULT_THREAD_POOL_QUEUE_SIZE
 #	define BIO_DEFAULT_THREAD_POOL_QUEUE_SIZE 2
 #endif
 
+/// The default number of threads in the blocking thread pool
+#ifndef BIO_DEFAULT_BLOCKING_POOL_SIZE
+#	define BIO_DEFAULT_BLOCKING_POOL_SIZE 1
+#endif
+
+/// The default maximum number of threads in the blocking thread pool
+#ifndef BIO_DEFAULT_BLOCKING_POOL_MAX_SIZE
+#	define BIO_DEFAULT_BLOCKING_POOL_MAX_SIZE 16
+#endif
+
+/// The default time async jobs can wait for a thread before the pool grows
+#ifndef BIO_DEFAULT_THREAD_POOL_SPAWN_DELAY_MS
+#	define BIO_DEFAULT_THREAD_POOL_SPAWN_DELAY_MS 10
+#endif
+
+/// The default time an extra async thread can stay idle before it exits
+#ifndef BIO_DEFAULT_THREAD_POOL_IDLE_TIMEOUT_MS
+#	define BIO_DEFAULT_THREAD_POOL_IDLE_TIMEOUT_MS 30000
+#endif
+
+/// The default number of pending @ref bio_spawn_on requests for a loop
+#ifndef BIO_DEFAULT_LOOP_INBOX_SIZE
+#	define BIO_DEFAULT_LOOP_INBOX_SIZE 64
+#endif
+
+/// Maximum number of requests an idle loop takes from another loop at once
+#ifndef BIO_DEFAULT_LOOP_STEAL_BATCH_SIZE
+#	define BIO_DEFAULT_LOOP_STEAL_BATCH_SIZE 16
+#endif
+
+/// The number of objects in the first chunk of a slab
+#ifndef BIO_DEFAULT_SLAB_MIN_CHUNK_SIZE
+#	define BIO_DEFAULT_SLAB_MIN_CHUNK_SIZE 16
+#endif
+
+/// The maximum number of objects in a chunk of a slab, chunks double in size until this
+#ifndef BIO_DEFAULT_SLAB_MAX_CHUNK_SIZE
+#	define BIO_DEFAULT_SLAB_MAX_CHUNK_SIZE 256
+#endif
+
+/// The default number of events buffered between two trace flushes
+#ifndef BIO_DEFAULT_TRACE_RING_SIZE
+#	define BIO_DEFAULT_TRACE_RING_SIZE 4096
+#endif
+
+/// The default interval between two trace flushes
+#ifndef BIO_DEFAULT_TRACE_FLUSH_INTERVAL_MS
+#	define BIO_DEFAULT_TRACE_FLUSH_INTERVAL_MS 100
+#endif
+
 /**@}*/
 
 #if defined(__linux__)
@@ -71,6 +152,8 @@
 
 #include <bio/bio.h>
 #include <stdio.h>
+#include <threads.h>
+#include <stdatomic.h>
 #include "array.h"
 
 #ifdef __GNUC__
@@ -124,20 +207,43 @@
 #	define BIO_ALIGN_TYPE max_align_t
 #endif
 
+#ifdef _MSC_VER
+#	define BIO_THREAD_LOCAL __declspec(thread)
+#else
+#	define BIO_THREAD_LOCAL _Thread_local
+#endif
+
+// The part of a handle slot which is checked on every resolve
 typedef struct {
 	const bio_tag_t* tag;
-	void* obj;
-
 	int32_t gen;
-	int32_t next_handle_slot;
-} bio_handle_slot_t;
+} bio_handle_meta_t;
 
 typedef struct mco_coro mco_coro;
 
+#define BIO_NUM_CORO_PRIORITIES (BIO_CORO_PRIORITY_LOW - BIO_CORO_PRIORITY_HIGH + 1)
+
 BIO_DEFINE_LIST_LINK(bio_signal_link);
 BIO_DEFINE_LIST_LINK(bio_logger_link);
 BIO_DEFINE_LIST_LINK(bio_monitor_link);
-BIO_DEFINE_LIST_LINK(bio_cls_link);
+BIO_DEFINE_LIST_LINK(bio_loop_link);
+BIO_DEFINE_LIST_LINK(bio_slab_chunk_link);
+BIO_DEFINE_LIST_LINK(bio_timer_link);
+BIO_DEFINE_LIST_LINK(bio_wait_group_link);
+
+// Allocator for objects of the same size.
+// Objects are carved out of chunks which grow geometrically.
+// A chunk is returned once all of its objects are freed, except for one which
+// is kept around to absorb the next burst.
+typedef struct {
+	size_t item_stride;
+	uint32_t next_chunk_capacity;
+	int32_t num_empty_chunks;
+	// All chunks
+	bio_slab_chunk_link_t chunks;
+	// Chunks with at least one free object, empty chunks are at the back
+	bio_slab_chunk_link_t partial_chunks;
+} bio_slab_t;
 
 typedef struct bio_coro_impl_s bio_coro_impl_t;
 
@@ -151,11 +257,9 @@ typedef struct {
 } bio_signal_impl_t;
 
 typedef struct {
-	bio_cls_link_t link;
 	const bio_cls_t* spec;
-
-	_Alignas(BIO_ALIGN_TYPE) char data[];
-} bio_cls_entry_t;
+	void* data;
+} bio_cls_slot_t;
 
 typedef struct {
 	bio_signal_t signal;
@@ -170,10 +274,24 @@ struct bio_coro_impl_s {
 	void* extra_data;
 	const bio_tag_t* extra_data_tag;
 	const char* name;
-	bio_cls_link_t* cls_buckets;
+
+	// CLS, the first few are stored inline and the rest go into an
+	// open-addressing table
+	bio_cls_slot_t inline_cls[BIO_NUM_INLINE_CLS];
+	bio_cls_slot_t* cls_slots;
+	int32_t cls_capacity;
+	int32_t num_cls;
 
 	bio_handle_t handle;
 	bio_coro_state_t state;
+	// Index into the ready lists
+	int priority;
+
+	// Only updated when stats collection is enabled
+	bio_coro_stats_t stats;
+	int64_t wait_start_ns;
+	// Index into the per-name stats, -1 if the coroutine has no name
+	int32_t name_stats_index;
 
 	bio_signal_link_t pending_signals;
 	bio_monitor_link_t monitors;
@@ -188,12 +306,70 @@ typedef struct {
 	bio_signal_t signal;
 } bio_monitor_impl_t;
 
-typedef struct bio_worker_thread_s bio_worker_thread_t;
+typedef struct {
+	bio_handle_t handle;
+	int counter;
+	bio_wait_group_link_t waiters;
+} bio_wait_group_impl_t;
+
+// A lightweight signal for internal blocking operations such as I/O requests.
+// It is embedded in the operation so it needs no allocation or handle.
+// Only the coroutine which prepared it can wait on it and it must not outlive
+// that wait.
+typedef struct {
+	bio_coro_impl_t* owner;
+	int wait_counter;
+	bool raised;
+} bio_waiter_t;
 
 typedef struct {
-	bio_time_t due_time_ms;
-	bio_signal_t signal;
-} bio_timer_entry_t;
+	char* name;
+	bio_coro_stats_t stats;
+} bio_coro_name_stats_t;
+
+typedef struct {
+	// Total size of the coroutine memory, derived from the stack size
+	size_t coro_size;
+	BIO_ARRAY(bio_coro_impl_t*) idle_coros;
+} bio_coro_pool_bucket_t;
+
+typedef struct bio_thread_pool_s bio_thread_pool_t;
+
+#define BIO_NUM_ASYNC_POOLS (BIO_ASYNC_BLOCKING + 1)
+
+typedef struct bio_trace_s bio_trace_t;
+
+typedef enum {
+	BIO_TRACE_RESUME,
+	BIO_TRACE_YIELD,
+	BIO_TRACE_WAIT,
+	BIO_TRACE_EXIT,
+	BIO_TRACE_RAISE,
+	BIO_TRACE_IO_SUBMIT,
+	BIO_TRACE_IO_COMPLETE,
+} bio_trace_event_type_t;
+
+#define BIO_TIMER_WHEEL_BITS 6
+#define BIO_TIMER_WHEEL_NUM_SLOTS (1 << BIO_TIMER_WHEEL_BITS)
+// With 1us ticks, this covers more than 8 years.
+// Longer timers are parked in the top level until they come into range.
+#define BIO_TIMER_WHEEL_NUM_LEVELS 8
+
+// Hierarchical timing wheel with 1us ticks.
+// Level N holds timers due within 64^(N+1) ticks, each slot spanning 64^N
+// ticks.
+// When the lower levels wrap around, a slot of the level above is cascaded
+// down.
+typedef struct {
+	bio_timer_link_t slots[BIO_TIMER_WHEEL_NUM_LEVELS][BIO_TIMER_WHEEL_NUM_SLOTS];
+	// One bit per non-empty slot so that empty ticks can be skipped
+	uint64_t occupied[BIO_TIMER_WHEEL_NUM_LEVELS];
+	// The first tick which has not been processed
+	bio_time_t next_tick;
+	int32_t num_entries;
+	// A callback may spawn the first coroutine which updates the timers again
+	bool is_expiring;
+} bio_timer_wheel_t;
 
 typedef struct {
 	char* ptr;
@@ -201,35 +377,100 @@ typedef struct {
 } bio_fmt_buf_t;
 
 typedef struct {
+	bio_entrypoint_t entrypoint;
+	void* userdata;
+	bio_coro_options_t options;
+} bio_spawn_request_t;
+
+// The part of a loop which other threads can reach through a bio_loop_t.
+// It is reference counted so it outlives the loop while other threads still
+// hold a reference.
+typedef struct {
+	atomic_int ref_count;
+
+	// Requests from other loops
+	mtx_t mtx;
+	// Set under the lock when the loop terminates, nothing else can be
+	// accessed from then on
+	bool closed;
+	bio_spawn_request_t* requests;
+	uint32_t capacity;
+	uint32_t head;
+	atomic_uint len;
+	bio_platform_t* platform;
+
+	// Spawn request stealing between loops.
+	// The link is only touched under the registry lock, other threads check
+	// the flag instead.
+	bio_loop_link_t stealing_link;
+	atomic_bool is_stealing;
+	atomic_bool is_idle;
+} bio_loop_impl_t;
+
+typedef struct bio_ctx_s {
 	bio_options_t options;
 	bool is_terminating;
 	BIO_ARRAY(bio_exit_info_t*) exit_handlers;
 
-	// Handle table
-	bio_handle_slot_t* handle_slots;
+	// Handle table, split into parallel arrays so that resolving a handle
+	// only touches the compact metadata until it is known to be valid
+	bio_handle_meta_t* handle_metas;
+	void** handle_objs;
+	int32_t* handle_free_list;
 	int32_t handle_capacity;
 	int32_t next_handle_slot;
 	int32_t num_handles;
 
 	// Timer
-	bio_timer_entry_t* timer_entries;
-	int32_t timer_capacity;
-	int32_t num_timers;
-	bio_time_t current_time_ms;
+	bio_timer_wheel_t timer_wheel;
+	bio_slab_t timer_slab;
+	// Timers created with bio_create_timer keep the loop running
+	int32_t num_active_timers;
+	// Cached at the start of every iteration, see bio_loop_time_us
+	bio_time_t current_time_us;
 
 	// Scheduler
-	BIO_ARRAY(bio_coro_impl_t*) current_ready_coros;
-	BIO_ARRAY(bio_coro_impl_t*) next_ready_coros;
+	// One ready list per priority, highest first
+	BIO_ARRAY(bio_coro_impl_t*) current_ready_coros[BIO_NUM_CORO_PRIORITIES];
+	BIO_ARRAY(bio_coro_impl_t*) next_ready_coros[BIO_NUM_CORO_PRIORITIES];
 	int32_t num_coros;
 	int32_t num_daemons;
+	int32_t num_resumes_since_poll;
+	BIO_ARRAY(bio_coro_name_stats_t) coro_name_stats;
+	// The coroutine most recently woken up by another coroutine
+	bio_coro_impl_t* lifo_coro;
+	int32_t num_lifo_runs;
+	// Finished coroutines kept for reuse, one bucket per stack size
+	BIO_ARRAY(bio_coro_pool_bucket_t) coro_pool;
+
+	// Only created by bio_current_loop
+	bio_loop_impl_t* loop_impl;
 
 	// Logging
 	bio_logger_link_t loggers;
 	int log_prefix_len;
 
+	// Slabs for small objects which are created and destroyed frequently.
+	// The file and socket slabs are initialized by the platform layer.
+	bio_slab_t signal_slab;
+	bio_slab_t monitor_slab;
+	bio_slab_t wait_group_slab;
+	bio_slab_t async_job_slab;
+	bio_slab_t async_batch_slab;
+	bio_slab_t file_slab;
+	bio_slab_t socket_slab;
+	bio_slab_t cls_slabs[BIO_NUM_CLS_SLABS];
+
+	// Tracing, NULL when disabled
+	bio_trace_t* trace;
+
 	// Thread pool
-	bio_worker_thread_t* thread_pool;
+	bio_thread_pool_t* thread_pools[BIO_NUM_ASYNC_POOLS];
 	int32_t num_running_async_jobs;
+	// The affinity of the loop thread before it was pinned, restored on
+	// cleanup
+	int* saved_loop_cpus;
+	int num_saved_loop_cpus;
 
 	// Platform specific
 	bio_platform_t platform;
@@ -241,7 +482,8 @@ typedef enum {
 	BIO_PLATFORM_UPDATE_WAIT_NOTIFIABLE,
 } bio_platform_update_type_t;
 
-extern bio_ctx_t bio_ctx;
+// Each thread that calls bio_init has its own context
+extern BIO_THREAD_LOCAL bio_ctx_t bio_ctx;
 
 static inline void*
 bio_realloc(void* ptr, size_t size) {
@@ -331,7 +573,8 @@ bio_platform_cleanup(void);
  * This function should use the platform's polling API to check for completion
  * status and raise the relevant I/O wait signals.
  *
- * @param wait_timeout_ms How much time to wait for I/O completion.
+ * @param wait_timeout_us How much time to wait for I/O completion, in
+ *   microseconds.
  *   This should be followed as closely as possible since bio relies on it for
  *   @ref bio_raise_signal_after "timing".
  *   If this is 0, the function should return as soon as there is no more pending
@@ -340,21 +583,66 @@ bio_platform_cleanup(void);
  *   one I/O event.
  * @param notifiable Should this wait be notifiable with @ref bio_platform_notify.
  *   When this is `false`, this function was called at a time when there is no
- *   pending async task.
+ *   pending async task and the loop was never shared with @ref bio_current_loop.
  *   It may choose to execute in a more efficient code path.
  */
 void
-bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable);
+bio_platform_update(bio_time_t wait_timeout_us, bool notifiable);
 
 /**
  * Make @ref bio_platform_update return
  *
- * This function will always be called from the async thread pool.
- * It must signal to @ref bio_platform_update in the main thread to return
- * regardless of I/O completion status.
+ * This function will always be called from a different thread: either the
+ * async thread pool or a different loop.
+ * It must signal to @ref bio_platform_update in the thread owning @p platform
+ * to return regardless of I/O completion status.
+ *
+ * @param platform The platform data of the loop to wake up
  */
 void
-bio_platform_notify(void);
+bio_platform_notify(bio_platform_t* platform);
+
+/**
+ * Block the calling thread while @p addr holds @p expected
+ *
+ * This is used to park idle threads of the async thread pool.
+ * It may return spuriously.
+ * Like @ref bio_platform_notify, it is called from other threads so it must
+ * not access the context.
+ *
+ * @param addr The address to wait on
+ * @param expected The value at @p addr to keep waiting for
+ * @param timeout_ms How long to wait for, a negative value means forever
+ * @return false if the wait timed out
+ */
+bool
+bio_platform_futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms);
+
+/**
+ * Restrict the calling thread to the given CPUs
+ *
+ * This is a best effort, CPUs which are not available are ignored.
+ * Like @ref bio_platform_notify, it is called from other threads so it must
+ * not access the context.
+ *
+ * @return `false` if the affinity could not be changed, for example, when
+ *   none of the CPUs are available.
+ *   The thread keeps its current affinity in that case.
+ */
+bool
+bio_platform_set_thread_affinity(const int* cpus, int num_cpus);
+
+/**
+ * Get the CPUs the calling thread is allowed to run on
+ *
+ * @return The number of CPUs written to @p cpus, at most @p max_cpus
+ */
+int
+bio_platform_get_thread_affinity(int* cpus, int max_cpus);
+
+/// Wake up to @p count threads blocked on @p addr in @ref bio_platform_futex_wait
+void
+bio_platform_futex_wake(atomic_uint* addr, int count);
 
 /**
  * Return the current time in milliseconds
@@ -364,6 +652,14 @@ bio_platform_notify(void);
 bio_time_t
 bio_platform_current_time_ms(void);
 
+/**
+ * Return a monotonic time in nanoseconds
+ *
+ * This is only used to measure durations so the epoch does not matter.
+ */
+int64_t
+bio_platform_current_time_ns(void);
+
 /// Called before the async thread pool is created
 void
 bio_platform_begin_create_thread_pool(void);
@@ -423,6 +719,21 @@ bio_handle_table_init(void);
 void
 bio_handle_table_cleanup(void);
 
+// Slab
+
+void
+bio_slab_init(bio_slab_t* slab, size_t item_size);
+
+// Release all chunks, including objects which were not freed
+void
+bio_slab_cleanup(bio_slab_t* slab);
+
+void*
+bio_slab_alloc(bio_slab_t* slab);
+
+void
+bio_slab_free(bio_slab_t* slab, void* ptr);
+
 // Timer
 
 void
@@ -434,8 +745,12 @@ bio_timer_cleanup(void);
 void
 bio_timer_update(void);
 
+void
+bio_timer_poll(void);
+
+// In microseconds, -1 if there is no timer
 bio_time_t
-bio_time_until_next_timer(void);
+bio_time_until_next_timer_us(void);
 
 // Scheduler
 
@@ -445,6 +760,22 @@ bio_scheduler_init(void);
 void
 bio_scheduler_cleanup(void);
 
+bool
+bio_scheduler_has_remote_requests(void);
+
+void
+bio_scheduler_drain_remote_requests(void);
+
+// Bind the waiter to the running coroutine
+void
+bio_prepare_waiter(bio_waiter_t* waiter);
+
+void
+bio_wait_for_waiter(bio_waiter_t* waiter);
+
+bool
+bio_raise_waiter(bio_waiter_t* waiter);
+
 // Thread
 
 void
@@ -456,6 +787,10 @@ bio_thread_cleanup(void);
 void
 bio_thread_update(void);
 
+/// Return how long the loop can wait before the thread pool has to grow, -1 if it does not
+bio_time_t
+bio_thread_time_until_resize_us(void);
+
 int32_t
 bio_num_running_async_jobs(void);
 
@@ -467,4 +802,18 @@ bio_logging_init(void);
 void
 bio_logging_cleanup(void);
 
+// Tracing
+// The event functions must only be called when bio_ctx.trace is not NULL
+
+void
+bio_trace_coro_event(bio_trace_event_type_t type, bio_coro_impl_t* coro);
+
+// Return whether the event was recorded so the matching completion is only
+// recorded for traced submissions
+bool
+bio_trace_io_event(bio_trace_event_type_t type, const void* request, int32_t value);
+
+void
+bio_trace_cleanup(void);
+
 #endif
@@ -3,12 +3,39 @@
 
 #include "../internal.h"
 
+typedef struct {
+	bio_waiter_t waiter;
+	int32_t res;
+	uint32_t flags;
+	// Whether the submission was recorded while tracing
+	bool traced;
+	// Whether the linked timeout fired and canceled the request
+	bool timed_out;
+	// The request and its linked timeout complete separately
+	uint8_t num_pending_cqes;
+} bio_io_req_t;
+
+// Returned by bio_submit_timed_io_req when the timeout fired.
+// This is outside the range of negated errno values.
+#define BIO_IO_TIMED_OUT INT32_MIN
+
 struct io_uring_sqe*
 bio_acquire_io_req(void);
 
 int
 bio_submit_io_req(struct io_uring_sqe* sqe, uint32_t* flags);
 
+// Acquire a request which can be followed by a linked timeout
+struct io_uring_sqe*
+bio_acquire_timed_io_req(bio_time_t timeout_ms);
+
+// Submit a request acquired with bio_acquire_timed_io_req.
+// It is canceled and BIO_IO_TIMED_OUT is returned if it does not complete
+// within timeout_ms.
+// A non-positive timeout waits indefinitely.
+int
+bio_submit_timed_io_req(struct io_uring_sqe* sqe, uint32_t* flags, bio_time_t timeout_ms);
+
 void
 bio_set_errno(bio_error_t* error, int code, const char* file, int line);
 
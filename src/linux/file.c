@@ -19,7 +19,7 @@ typedef struct {
 
 static bio_file_t
 bio_file_from_fd(int fd, int64_t offset, bool seekable) {
-	bio_file_impl_t* file_impl = bio_malloc(sizeof(bio_file_impl_t));
+	bio_file_impl_t* file_impl = bio_slab_alloc(&bio_ctx.file_slab);
 	*file_impl = (bio_file_impl_t){
 		.fd = fd,
 		.offset = seekable ? offset : -1,
@@ -32,6 +32,8 @@ bio_file_from_fd(int fd, int64_t offset, bool seekable) {
 
 void
 bio_fs_init(void) {
+	bio_slab_init(&bio_ctx.file_slab, sizeof(bio_file_impl_t));
+
 	BIO_STDIN = bio_file_from_fd(0, -1, false);
 	BIO_STDOUT = bio_file_from_fd(1, -1, false);
 	BIO_STDERR = bio_file_from_fd(2, -1, false);
@@ -39,9 +41,11 @@ bio_fs_init(void) {
 
 void
 bio_fs_cleanup(void) {
-	bio_free(bio_close_handle(BIO_STDIN.handle, &BIO_FILE_HANDLE));
-	bio_free(bio_close_handle(BIO_STDOUT.handle, &BIO_FILE_HANDLE));
-	bio_free(bio_close_handle(BIO_STDERR.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDIN.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDOUT.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDERR.handle, &BIO_FILE_HANDLE));
+
+	bio_slab_cleanup(&bio_ctx.file_slab);
 }
 
 typedef struct {
@@ -109,7 +113,7 @@ bio_fopen(
 			.fd = fd,
 			.whence = (flags & O_APPEND) > 0 ? SEEK_END : SEEK_CUR,
 		};
-		bio_run_async_and_wait(bio_fs_test_lseek, &args);
+		bio_run_async_and_wait_ex(bio_fs_test_lseek, &args, BIO_ASYNC_BLOCKING);
 		*file_ptr = bio_file_from_fd(fd, args.result, args.result >= 0);
 		return true;
 	} else {
@@ -148,13 +152,29 @@ bio_fread(
 	void* buf,
 	size_t size,
 	bio_error_t* error
+) {
+	return bio_fread_ex(file, buf, size, 0, error);
+}
+
+size_t
+bio_fread_ex(
+	bio_file_t file,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
 ) {
 	bio_file_impl_t* impl = bio_resolve_handle(file.handle, &BIO_FILE_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
-		struct io_uring_sqe* sqe = bio_acquire_io_req();
+		struct io_uring_sqe* sqe = bio_acquire_timed_io_req(timeout_ms);
 		size = size < (size_t)INT32_MAX ? size : (size_t)INT32_MAX;
 		io_uring_prep_read(sqe, impl->fd, buf, size, impl->offset);
-		int result = bio_submit_io_req(sqe, NULL);
+		int result = bio_submit_timed_io_req(sqe, NULL, timeout_ms);
+		if (result == BIO_IO_TIMED_OUT) {
+			bio_set_core_error(error, BIO_ERROR_TIMED_OUT);
+			return 0;
+		}
+
 		size_t bytes_read = bio_result_to_size(result, error);
 		if (impl->seekable) {
 			impl->offset += bytes_read;
@@ -185,7 +205,7 @@ bio_fclose(bio_file_t file, bio_error_t* error) {
 	bio_file_impl_t* impl = bio_close_handle(file.handle, &BIO_FILE_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
 		int fd = impl->fd;
-		bio_free(impl);
+		bio_slab_free(&bio_ctx.file_slab, impl);
 		int result = bio_io_close(fd);
 		return bio_result_to_bool(result, error);
 	} else {
@@ -146,7 +146,7 @@ bio_make_socket(
 
 static bio_socket_t
 bio_socket_from_fd(int fd) {
-	bio_socket_impl_t* sock_impl = bio_malloc(sizeof(bio_socket_impl_t));
+	bio_socket_impl_t* sock_impl = bio_slab_alloc(&bio_ctx.socket_slab);
 	*sock_impl = (bio_socket_impl_t){ .fd = fd };
 	return (bio_socket_t){
 		.handle = bio_make_handle(sock_impl, &BIO_SOCKET_HANDLE),
@@ -155,10 +155,12 @@ bio_socket_from_fd(int fd) {
 
 void
 bio_net_init(void) {
+	bio_slab_init(&bio_ctx.socket_slab, sizeof(bio_socket_impl_t));
 }
 
 void
 bio_net_cleanup(void) {
+	bio_slab_cleanup(&bio_ctx.socket_slab);
 }
 
 bool
@@ -223,15 +225,28 @@ bio_net_accept(
 	bio_socket_t socket,
 	bio_socket_t* client,
 	bio_error_t* error
+) {
+	return bio_net_accept_ex(socket, client, 0, error);
+}
+
+bool
+bio_net_accept_ex(
+	bio_socket_t socket,
+	bio_socket_t* client,
+	bio_time_t timeout_ms,
+	bio_error_t* error
 ) {
 	bio_socket_impl_t* impl = bio_resolve_handle(socket.handle, &BIO_SOCKET_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
-		struct io_uring_sqe* sqe = bio_acquire_io_req();
+		struct io_uring_sqe* sqe = bio_acquire_timed_io_req(timeout_ms);
 		io_uring_prep_accept(sqe, impl->fd, NULL, NULL, 0);
-		int result = bio_submit_io_req(sqe, NULL);
+		int result = bio_submit_timed_io_req(sqe, NULL, timeout_ms);
 		if (result > 0) {
 			*client = bio_socket_from_fd(result);
 			return true;
+		} else if (result == BIO_IO_TIMED_OUT) {
+			bio_set_core_error(error, BIO_ERROR_TIMED_OUT);
+			return false;
 		} else {
 			bio_set_errno(error, -result);
 			return false;
@@ -249,6 +264,18 @@ bio_net_connect(
 	bio_port_t port,
 	bio_socket_t* sock,
 	bio_error_t* error
+) {
+	return bio_net_connect_ex(socket_type, addr, port, sock, 0, error);
+}
+
+bool
+bio_net_connect_ex(
+	bio_socket_type_t socket_type,
+	const bio_addr_t* addr,
+	bio_port_t port,
+	bio_socket_t* sock,
+	bio_time_t timeout_ms,
+	bio_error_t* error
 ) {
 	bio_addr_translation_result_t translation_result = { 0 };
 	if (!bio_translate_address(addr, port, &translation_result, error)) {
@@ -261,10 +288,14 @@ bio_net_connect(
 	int fd = bio_make_socket(socket_type, &src_addr, BIO_PORT_ANY, error);
 	if (fd < 0) { return false; }
 
-	struct io_uring_sqe* sqe = bio_acquire_io_req();
+	struct io_uring_sqe* sqe = bio_acquire_timed_io_req(timeout_ms);
 	io_uring_prep_connect(sqe, fd, translation_result.addr, translation_result.addr_len);
-	int result = bio_submit_io_req(sqe, NULL);
-	if (result < 0) {
+	int result = bio_submit_timed_io_req(sqe, NULL, timeout_ms);
+	if (result == BIO_IO_TIMED_OUT) {
+		bio_set_core_error(error, BIO_ERROR_TIMED_OUT);
+		bio_io_close(fd);
+		return false;
+	} else if (result < 0) {
 		bio_set_errno(error, -result);
 		bio_io_close(fd);
 		return false;
@@ -279,7 +310,7 @@ bio_net_close(bio_socket_t socket, bio_error_t* error) {
 	bio_socket_impl_t* impl = bio_close_handle(socket.handle, &BIO_SOCKET_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
 		int fd = impl->fd;
-		bio_free(impl);
+		bio_slab_free(&bio_ctx.socket_slab, impl);
 
 		struct io_uring_sqe* sqe = bio_acquire_io_req();
 		io_uring_prep_shutdown(sqe, fd, SHUT_RDWR);
@@ -304,12 +335,28 @@ bio_net_send(
 	const void* buf,
 	size_t size,
 	bio_error_t* error
+) {
+	return bio_net_send_ex(socket, buf, size, 0, error);
+}
+
+size_t
+bio_net_send_ex(
+	bio_socket_t socket,
+	const void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
 ) {
 	bio_socket_impl_t* impl = bio_resolve_handle(socket.handle, &BIO_SOCKET_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
-		struct io_uring_sqe* sqe = bio_acquire_io_req();
+		struct io_uring_sqe* sqe = bio_acquire_timed_io_req(timeout_ms);
 		io_uring_prep_send(sqe, impl->fd, buf, size, 0);
-		int result = bio_submit_io_req(sqe, NULL);
+		int result = bio_submit_timed_io_req(sqe, NULL, timeout_ms);
+		if (result == BIO_IO_TIMED_OUT) {
+			bio_set_core_error(error, BIO_ERROR_TIMED_OUT);
+			return 0;
+		}
+
 		return bio_result_to_size(result, error);
 	} else {
 		bio_set_core_error(error, BIO_ERROR_INVALID_ARGUMENT);
@@ -323,12 +370,28 @@ bio_net_recv(
 	void* buf,
 	size_t size,
 	bio_error_t* error
+) {
+	return bio_net_recv_ex(socket, buf, size, 0, error);
+}
+
+size_t
+bio_net_recv_ex(
+	bio_socket_t socket,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
 ) {
 	bio_socket_impl_t* impl = bio_resolve_handle(socket.handle, &BIO_SOCKET_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
-		struct io_uring_sqe* sqe = bio_acquire_io_req();
+		struct io_uring_sqe* sqe = bio_acquire_timed_io_req(timeout_ms);
 		io_uring_prep_recv(sqe, impl->fd, buf, size, 0);
-		int result = bio_submit_io_req(sqe, NULL);
+		int result = bio_submit_timed_io_req(sqe, NULL, timeout_ms);
+		if (result == BIO_IO_TIMED_OUT) {
+			bio_set_core_error(error, BIO_ERROR_TIMED_OUT);
+			return 0;
+		}
+
 		return bio_result_to_size(result, error);
 	} else {
 		bio_set_core_error(error, BIO_ERROR_INVALID_ARGUMENT);
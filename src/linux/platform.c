@@ -2,13 +2,19 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <sys/eventfd.h>
 #include <linux/futex.h>
 #include <sys/syscall.h>
+#include <sched.h>
 
 static const bio_tag_t BIO_PLATFORM_ERROR = BIO_TAG_INIT("bio.error.linux");
 
 static const char BIO_SIGNAL_POLL_DATA = 0;
+static const char BIO_NOTIFY_POLL_DATA = 0;
+
+// Set in the user data of a linked timeout which points to its request
+#define BIO_IO_TIMEOUT_TAG ((uintptr_t)1)
 
 static inline int
 futex(
@@ -49,7 +55,13 @@ bio_platform_init(void) {
 		| IORING_SETUP_COOP_TASKRUN
 		| IORING_SETUP_SINGLE_ISSUER
 		| IORING_SETUP_DEFER_TASKRUN;
-	int result = io_uring_queue_init(queue_size, &bio_ctx.platform.ioring, flags);
+	// Let the kernel tell us when there are completions waiting to be
+	// processed so that we only enter it when needed
+	int result = io_uring_queue_init(queue_size, &bio_ctx.platform.ioring, flags | IORING_SETUP_TASKRUN_FLAG);
+	bio_ctx.platform.has_taskrun_flag = result >= 0;
+	if (result < 0) {
+		result = io_uring_queue_init(queue_size, &bio_ctx.platform.ioring, flags);
+	}
 	if (result < 0) {
 		fprintf(stderr, "Could not create io_uring: %s\n", strerror(errno));
 		abort();
@@ -93,16 +105,36 @@ bio_drain_io_completions(void) {
 	unsigned i = 0;
 
 	io_uring_for_each_cqe(&bio_ctx.platform.ioring, head, cqe) {
+		--bio_ctx.platform.num_inflight_reqs;
+
 		void* userdata = io_uring_cqe_get_data(cqe);
 		if (userdata == (void*)&BIO_SIGNAL_POLL_DATA) {
 			bio_ctx.platform.signal_polled = false;
 			bio_platform_poll_signal();
 			bio_handle_exit_signal();
+		} else if (userdata == (void*)&BIO_NOTIFY_POLL_DATA) {
+			bio_ctx.platform.notify_polled = false;
 		} else if (BIO_LIKELY(userdata != NULL)) {
-			bio_io_req_t* request = userdata;
-			request->res = cqe->res;
-			request->flags = cqe->flags;
-			bio_raise_signal(request->signal);
+			bio_io_req_t* request;
+			if (((uintptr_t)userdata & BIO_IO_TIMEOUT_TAG) != 0) {
+				request = (bio_io_req_t*)((uintptr_t)userdata & ~BIO_IO_TIMEOUT_TAG);
+				// A linked timeout only completes with -ETIME when it
+				// fired and canceled its request
+				request->timed_out = cqe->res == -ETIME;
+			} else {
+				request = userdata;
+				request->res = cqe->res;
+				request->flags = cqe->flags;
+				if (request->traced && bio_ctx.trace != NULL) {
+					bio_trace_io_event(BIO_TRACE_IO_COMPLETE, request, cqe->res);
+				}
+			}
+
+			// The request must stay alive until all of its completions
+			// were processed
+			if (--request->num_pending_cqes == 0) {
+				bio_raise_waiter(&request->waiter);
+			}
 		}
 
 		++i;
@@ -112,15 +144,15 @@ bio_drain_io_completions(void) {
 }
 
 static void
-bio_platform_update_wait(bio_time_t wait_timeout_ms, bool notifiable) {
+bio_platform_update_wait(bio_time_t wait_timeout_us, bool notifiable) {
 	struct io_uring* ioring = &bio_ctx.platform.ioring;
 
-	if (wait_timeout_ms > 0) {  // Wait with timeout
+	if (wait_timeout_us > 0) {  // Wait with timeout
 		struct io_uring_cqe* cqe = NULL;
 
 		struct __kernel_timespec timespec = {
-			.tv_sec = wait_timeout_ms / 1000,
-			.tv_nsec = (wait_timeout_ms % 1000) * 1000000,
+			.tv_sec = wait_timeout_us / 1000000,
+			.tv_nsec = (wait_timeout_us % 1000000) * 1000,
 		};
 		int num_submitted = io_uring_submit_and_wait_timeout(ioring, &cqe, 1, &timespec, NULL);
 
@@ -138,16 +170,37 @@ bio_platform_update_wait(bio_time_t wait_timeout_ms, bool notifiable) {
 	}
 }
 
+static bool
+bio_platform_should_enter(void) {
+	struct io_uring* ioring = &bio_ctx.platform.ioring;
+
+	// New requests
+	if (io_uring_sq_ready(ioring) > 0) { return true; }
+
+	// Nothing can complete
+	if (bio_ctx.platform.num_inflight_reqs == 0) { return false; }
+
+	// Without the flag, there is no way to tell whether completions are
+	// waiting to be run
+	if (!bio_ctx.platform.has_taskrun_flag) { return true; }
+
+	unsigned int sq_flags = IO_URING_READ_ONCE(*ioring->sq.kflags);
+	return (sq_flags & (IORING_SQ_TASKRUN | IORING_SQ_CQ_OVERFLOW)) != 0;
+}
+
 static void
 bio_platform_update_no_wait(void) {
 	struct io_uring* ioring = &bio_ctx.platform.ioring;
-	io_uring_submit_and_get_events(ioring);
+	if (bio_platform_should_enter()) {
+		io_uring_submit_and_get_events(ioring);
+	}
+	// Completions that were already posted can be read directly from the ring
 	bio_drain_io_completions();
 }
 
 void
-bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
-	if (wait_timeout_ms == 0) {  // No wait
+bio_platform_update(bio_time_t wait_timeout_us, bool notifiable) {
+	if (wait_timeout_us == 0) {  // No wait
 		bio_platform_update_no_wait();
 	} else {
 		if (bio_ctx.platform.has_op_futex_wait) { // Using futex for notification
@@ -157,7 +210,10 @@ bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
 				bio_platform_update_no_wait();
 				bio_ctx.platform.ack_counter = notification_counter;
 			} else {
-				if (notifiable) {
+				// A previous wait may still be pending if it was interrupted by
+				// something else.
+				// It is still waiting on the same value so it can be reused.
+				if (notifiable && !bio_ctx.platform.notify_polled) {
 					struct io_uring_sqe* sqe = bio_acquire_io_req();
 					io_uring_prep_futex_wait(
 						sqe,
@@ -167,37 +223,38 @@ bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
 						FUTEX2_SIZE_U32 | FUTEX2_PRIVATE,
 						0
 					);
-					io_uring_sqe_set_data(sqe, NULL);
+					io_uring_sqe_set_data(sqe, (void*)&BIO_NOTIFY_POLL_DATA);
+					bio_ctx.platform.notify_polled = true;
 				}
 
-				bio_platform_update_wait(wait_timeout_ms, notifiable);
+				bio_platform_update_wait(wait_timeout_us, notifiable);
 				bio_ctx.platform.ack_counter = atomic_load(&bio_ctx.platform.notification_counter);
 			}
 		} else { // Using eventfd for notification
 			// Read from the eventfd so async threads can notify by writing to it
-			uint64_t counter;
-			if (notifiable) {
+			if (notifiable && !bio_ctx.platform.notify_polled) {
 				struct io_uring_sqe* sqe = bio_acquire_io_req();
 				io_uring_prep_read(
 					sqe,
 					bio_ctx.platform.eventfd,
-					&counter, sizeof(counter),
+					&bio_ctx.platform.eventfd_value, sizeof(bio_ctx.platform.eventfd_value),
 					0
 				);
-				io_uring_sqe_set_data(sqe, NULL);
+				io_uring_sqe_set_data(sqe, (void*)&BIO_NOTIFY_POLL_DATA);
+				bio_ctx.platform.notify_polled = true;
 			}
 
-			bio_platform_update_wait(wait_timeout_ms, notifiable);
+			bio_platform_update_wait(wait_timeout_us, notifiable);
 		}
 	}
 }
 
 void
-bio_platform_notify(void) {
-	if (bio_ctx.platform.has_op_futex_wait) {
-		atomic_fetch_add(&bio_ctx.platform.notification_counter, 1);
+bio_platform_notify(bio_platform_t* platform) {
+	if (platform->has_op_futex_wait) {
+		atomic_fetch_add(&platform->notification_counter, 1);
 		futex(
-			(uint32_t*)&bio_ctx.platform.notification_counter,
+			(uint32_t*)&platform->notification_counter,
 			FUTEX_WAKE_BITSET | (FUTEX2_SIZE_U32 | FUTEX2_PRIVATE),
 			1,
 			NULL,
@@ -206,8 +263,48 @@ bio_platform_notify(void) {
 		);
 	} else {
 		uint64_t counter = 1;
-		write(bio_ctx.platform.eventfd, &counter, sizeof(counter));
+		write(platform->eventfd, &counter, sizeof(counter));
+	}
+}
+
+bool
+bio_platform_futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms) {
+	struct timespec timeout = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (long)(timeout_ms % 1000) * 1000000L,
+	};
+	int result = futex(
+		(uint32_t*)addr, FUTEX_WAIT_PRIVATE, expected,
+		timeout_ms >= 0 ? &timeout : NULL, NULL, 0
+	);
+	return !(result < 0 && errno == ETIMEDOUT);
+}
+
+void
+bio_platform_futex_wake(atomic_uint* addr, int count) {
+	futex((uint32_t*)addr, FUTEX_WAKE_PRIVATE, (uint32_t)count, NULL, NULL, 0);
+}
+
+bool
+bio_platform_set_thread_affinity(const int* cpus, int num_cpus) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int i = 0; i < num_cpus; ++i) {
+		if (0 <= cpus[i] && cpus[i] < CPU_SETSIZE) { CPU_SET(cpus[i], &set); }
 	}
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+int
+bio_platform_get_thread_affinity(int* cpus, int max_cpus) {
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof(set), &set) != 0) { return 0; }
+
+	int num_cpus = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE && num_cpus < max_cpus; ++cpu) {
+		if (CPU_ISSET(cpu, &set)) { cpus[num_cpus++] = cpu; }
+	}
+	return num_cpus;
 }
 
 bio_time_t
@@ -217,6 +314,13 @@ bio_platform_current_time_ms(void) {
 	return (timespec.tv_sec * 1000L) + (timespec.tv_nsec / 1000000L);
 }
 
+int64_t
+bio_platform_current_time_ns(void) {
+	struct timespec timespec;
+	clock_gettime(CLOCK_MONOTONIC, &timespec);
+	return (timespec.tv_sec * 1000000000L) + timespec.tv_nsec;
+}
+
 void
 bio_platform_begin_create_thread_pool(void) {
 	// block all signals before creating new threads so only the main thread
@@ -240,21 +344,75 @@ bio_acquire_io_req(void) {
 		bio_drain_io_completions();
 	}
 
+	// Every request produces exactly one completion
+	++bio_ctx.platform.num_inflight_reqs;
 	return sqe;
 }
 
+struct io_uring_sqe*
+bio_acquire_timed_io_req(bio_time_t timeout_ms) {
+	if (timeout_ms > 0) {
+		// The linked timeout must land in the same submission as the request.
+		// Otherwise, the link would be broken.
+		while (io_uring_sq_space_left(&bio_ctx.platform.ioring) < 2) {
+			io_uring_submit_and_get_events(&bio_ctx.platform.ioring);
+			bio_drain_io_completions();
+		}
+	}
+
+	return bio_acquire_io_req();
+}
+
+static void
+bio_wait_for_io_req(struct io_uring_sqe* sqe, bio_io_req_t* req, uint8_t num_cqes) {
+	bio_prepare_waiter(&req->waiter);
+	req->traced = false;
+	req->timed_out = false;
+	req->num_pending_cqes = num_cqes;
+	io_uring_sqe_set_data(sqe, req);
+	if (bio_ctx.trace != NULL) {
+		req->traced = bio_trace_io_event(BIO_TRACE_IO_SUBMIT, req, sqe->opcode);
+	}
+	bio_wait_for_waiter(&req->waiter);
+}
+
 int
 bio_submit_io_req(struct io_uring_sqe* sqe, uint32_t* flags) {
-	bio_io_req_t req = {
-		.signal = bio_make_signal(),
-	};
-	io_uring_sqe_set_data(sqe, &req);
-	bio_wait_for_one_signal(req.signal);
+	// The request lives on the stack of the waiting coroutine until its
+	// completion is processed
+	bio_io_req_t req;
+	bio_wait_for_io_req(sqe, &req, 1);
 
 	if (flags != NULL) { *flags = req.flags; }
 	return req.res;
 }
 
+int
+bio_submit_timed_io_req(struct io_uring_sqe* sqe, uint32_t* flags, bio_time_t timeout_ms) {
+	if (timeout_ms <= 0) { return bio_submit_io_req(sqe, flags); }
+
+	// Space was reserved by bio_acquire_timed_io_req
+	struct io_uring_sqe* timeout_sqe = io_uring_get_sqe(&bio_ctx.platform.ioring);
+	++bio_ctx.platform.num_inflight_reqs;
+
+	// The kernel only reads this during submission which happens while the
+	// coroutine is waiting
+	struct __kernel_timespec timeout = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (timeout_ms % 1000) * 1000000,
+	};
+	bio_io_req_t req;
+	sqe->flags |= IOSQE_IO_LINK;
+	io_uring_prep_link_timeout(timeout_sqe, &timeout, 0);
+	io_uring_sqe_set_data(timeout_sqe, (void*)((uintptr_t)&req | BIO_IO_TIMEOUT_TAG));
+	bio_wait_for_io_req(sqe, &req, 2);
+
+	if (flags != NULL) { *flags = req.flags; }
+	// The request may still have completed on its own if the timeout fired
+	// too late to cancel it
+	return req.timed_out && req.res < 0 ? BIO_IO_TIMED_OUT : req.res;
+}
+
 static
 const char* bio_format_errno(int code) {
 	return strerror(code);
@@ -34,14 +34,12 @@
 
 #ifndef DOXYGEN
 
-typedef struct {
-	bio_signal_t signal;
-	int32_t res;
-	uint32_t flags;
-} bio_io_req_t;
-
 typedef struct {
 	struct io_uring ioring;
+	// Requests which have been acquired but whose completions were not
+	// processed yet
+	unsigned int num_inflight_reqs;
+	bool has_taskrun_flag;
 
 	// Signal handling
 	struct signalfd_siginfo siginfo;
@@ -49,10 +47,12 @@ typedef struct {
 	int signalfd;
 	bool signal_polled;
 
-	// Notification from thread pool
+	// Notification from thread pool and other loops
 	int eventfd;
+	uint64_t eventfd_value;
 	atomic_uint notification_counter;
 	unsigned int ack_counter;
+	bool notify_polled;
 
 	// Compatibility
 	bool has_op_bind;
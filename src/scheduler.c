@@ -6,6 +6,60 @@ static const bio_tag_t BIO_CORO_HANDLE = BIO_TAG_INIT("bio.handle.coro");
 static const bio_tag_t BIO_SIGNAL_HANDLE = BIO_TAG_INIT("bio.handle.signal");
 static const bio_tag_t BIO_MONITOR_HANDLE = BIO_TAG_INIT("bio.handle.monitor");
 
+// Signals are resolved in batches of this size while waiting
+#define BIO_SIGNAL_BATCH_SIZE 16
+
+// A signal is just a handle so an array of signals can be resolved as an
+// array of handles
+_Static_assert(sizeof(bio_signal_t) == sizeof(bio_handle_t), "bio_signal_t must only contain a handle");
+
+// Loops which opted into spawn request stealing, shared between all threads.
+// Lock order: registry then loop.
+static once_flag bio_stealing_registry_once = ONCE_FLAG_INIT;
+static mtx_t bio_stealing_registry_mtx;
+static bio_loop_link_t bio_stealing_registry;
+
+static void
+bio_stealing_registry_init(void) {
+	mtx_init(&bio_stealing_registry_mtx, mtx_plain);
+	BIO_LIST_INIT(&bio_stealing_registry);
+}
+
+static inline int
+bio_coro_priority_index(bio_coro_priority_t priority) {
+	if (priority < BIO_CORO_PRIORITY_HIGH) { priority = BIO_CORO_PRIORITY_HIGH; }
+	if (priority > BIO_CORO_PRIORITY_LOW) { priority = BIO_CORO_PRIORITY_LOW; }
+	return (int)priority - (int)BIO_CORO_PRIORITY_HIGH;
+}
+
+static inline void
+bio_schedule_coro(bio_coro_impl_t* coro) {
+	bio_array_push(bio_ctx.next_ready_coros[coro->priority], coro);
+}
+
+// A coroutine woken up by another running coroutine is put into the LIFO
+// slot so it runs right after the waker suspends, while the data it was
+// woken up for is still hot.
+static void
+bio_schedule_woken_coro(bio_coro_impl_t* coro) {
+	mco_coro* running = mco_running();
+	if (
+		running != NULL
+		&& bio_ctx.options.scheduler.lifo_slot
+		&& bio_ctx.num_lifo_runs < bio_ctx.options.scheduler.max_lifo_runs
+		// Do not let it jump ahead of higher priority coroutines
+		&& coro->priority <= ((bio_coro_impl_t*)running->user_data)->priority
+	) {
+		// Only the latest one is kept, the previous one goes to the back
+		if (bio_ctx.lifo_coro != NULL) {
+			bio_schedule_coro(bio_ctx.lifo_coro);
+		}
+		bio_ctx.lifo_coro = coro;
+	} else {
+		bio_schedule_coro(coro);
+	}
+}
+
 void
 bio_scheduler_init(void) {
 	bio_ctx.num_coros = 0;
@@ -15,100 +69,490 @@ bio_scheduler_init(void) {
 	} else {
 		bio_ctx.options.num_cls_buckets = bio_next_pow2(bio_ctx.options.num_cls_buckets);
 	}
+	if (bio_ctx.options.coro_pool.max_idle_coros == 0) {
+		bio_ctx.options.coro_pool.max_idle_coros = BIO_DEFAULT_CORO_POOL_SIZE;
+	}
+	if (bio_ctx.options.scheduler.max_lifo_runs == 0) {
+		bio_ctx.options.scheduler.max_lifo_runs = BIO_DEFAULT_MAX_LIFO_RUNS;
+	}
+	bio_ctx.num_resumes_since_poll = 0;
+	bio_ctx.num_lifo_runs = 0;
+	bio_ctx.lifo_coro = NULL;
+	bio_slab_init(&bio_ctx.signal_slab, sizeof(bio_signal_impl_t));
+	bio_slab_init(&bio_ctx.monitor_slab, sizeof(bio_monitor_impl_t));
+	bio_slab_init(&bio_ctx.wait_group_slab, sizeof(bio_wait_group_impl_t));
+	for (int i = 0; i < BIO_NUM_CLS_SLABS; ++i) {
+		bio_slab_init(&bio_ctx.cls_slabs[i], (size_t)BIO_MIN_CLS_SLAB_ITEM_SIZE << i);
+	}
 }
 
 void
 bio_scheduler_cleanup(void) {
-	bio_array_free(bio_ctx.next_ready_coros);
-	bio_array_free(bio_ctx.current_ready_coros);
-	bio_ctx.next_ready_coros = NULL;
-	bio_ctx.current_ready_coros = NULL;
+	for (int priority = 0; priority < BIO_NUM_CORO_PRIORITIES; ++priority) {
+		bio_array_free(bio_ctx.next_ready_coros[priority]);
+		bio_array_free(bio_ctx.current_ready_coros[priority]);
+		bio_ctx.next_ready_coros[priority] = NULL;
+		bio_ctx.current_ready_coros[priority] = NULL;
+	}
+
+	size_t num_buckets = bio_array_len(bio_ctx.coro_pool);
+	for (size_t bucket_index = 0; bucket_index < num_buckets; ++bucket_index) {
+		bio_coro_pool_bucket_t* bucket = &bio_ctx.coro_pool[bucket_index];
+		size_t num_coros = bio_array_len(bucket->idle_coros);
+		for (size_t coro_index = 0; coro_index < num_coros; ++coro_index) {
+			bio_coro_impl_t* coro = bucket->idle_coros[coro_index];
+			mco_destroy(coro->impl);
+			bio_free(coro);
+		}
+		bio_array_free(bucket->idle_coros);
+	}
+	bio_array_free(bio_ctx.coro_pool);
+	bio_ctx.coro_pool = NULL;
+
+	size_t num_name_stats = bio_array_len(bio_ctx.coro_name_stats);
+	for (size_t i = 0; i < num_name_stats; ++i) {
+		bio_free(bio_ctx.coro_name_stats[i].name);
+	}
+	bio_array_free(bio_ctx.coro_name_stats);
+	bio_ctx.coro_name_stats = NULL;
+
+	bio_slab_cleanup(&bio_ctx.signal_slab);
+	bio_slab_cleanup(&bio_ctx.monitor_slab);
+	bio_slab_cleanup(&bio_ctx.wait_group_slab);
+	for (int i = 0; i < BIO_NUM_CLS_SLABS; ++i) {
+		bio_slab_cleanup(&bio_ctx.cls_slabs[i]);
+	}
+
+	bio_loop_impl_t* loop = bio_ctx.loop_impl;
+	if (loop != NULL) {
+		// Make sure no other loops can steal from or wake this one
+		if (atomic_load(&loop->is_stealing)) {
+			atomic_store(&loop->is_stealing, false);
+			mtx_lock(&bio_stealing_registry_mtx);
+			BIO_LIST_REMOVE(&loop->stealing_link);
+			mtx_unlock(&bio_stealing_registry_mtx);
+		}
+
+		// Requests that arrived after the loop exited are dropped and new
+		// ones are rejected
+		mtx_lock(&loop->mtx);
+		loop->closed = true;
+		bio_free(loop->requests);
+		loop->requests = NULL;
+		atomic_store(&loop->len, 0);
+		mtx_unlock(&loop->mtx);
+
+		bio_release_loop((bio_loop_t){ .ctx = loop });
+		bio_ctx.loop_impl = NULL;
+	}
+}
+
+bool
+bio_scheduler_has_remote_requests(void) {
+	return bio_ctx.loop_impl != NULL
+		&& atomic_load_explicit(&bio_ctx.loop_impl->len, memory_order_acquire) > 0;
 }
 
 void
-bio_loop(void) {
-	while (true) {
-		// Pop and run coros off the current list until it is empty
-		int num_coros = (int)bio_array_len(bio_ctx.current_ready_coros);
-		for (int coro_index = 0; coro_index < num_coros; ++coro_index) {
-			bio_coro_impl_t* coro = bio_ctx.current_ready_coros[coro_index];
-			coro->state = BIO_CORO_RUNNING;
-			coro->num_blocking_signals = 0;
-			mco_resume(coro->impl);
-			if (mco_status(coro->impl) != MCO_DEAD) {
-				bool waiting = coro->num_blocking_signals > 0;
-				coro->state = waiting ? BIO_CORO_WAITING : BIO_CORO_READY;
-				if (!waiting) {
-					bio_array_push(bio_ctx.next_ready_coros, coro);
-				}
-			} else {
-				// Cleanup all CLS
-				bio_cls_link_t* buckets = coro->cls_buckets;
-				int num_buckets = bio_ctx.options.num_cls_buckets;
-				for (int bucket_index = 0; bucket_index < num_buckets && buckets != NULL; ++bucket_index) {
-					bio_cls_link_t* bucket = &buckets[bucket_index];
-					for (
-						bio_cls_link_t* itr = bucket->next;
-						itr != bucket;
-					) {
-						bio_cls_link_t* next = itr->next;
-						bio_cls_entry_t* entry = BIO_CONTAINER_OF(itr, bio_cls_entry_t, link);
-
-						const bio_cls_t* cls = entry->spec;
-						if (cls->cleanup != NULL) { cls->cleanup(entry->data); }
-						bio_free(entry);
-
-						itr = next;
-					}
-				}
-				bio_free(buckets);
+bio_scheduler_drain_remote_requests(void) {
+	if (!bio_scheduler_has_remote_requests()) { return; }
 
-				// Destroy all signals
-				for (
-					bio_signal_link_t* itr = coro->pending_signals.next;
-					itr != &coro->pending_signals;
-				) {
-					bio_signal_link_t* next = itr->next;
+	bio_loop_impl_t* loop = bio_ctx.loop_impl;
+	mtx_lock(&loop->mtx);
+	uint32_t len = atomic_load_explicit(&loop->len, memory_order_relaxed);
+	for (uint32_t i = 0; i < len; ++i) {
+		bio_spawn_request_t* request = &loop->requests[(loop->head + i) & (loop->capacity - 1)];
+		bio_spawn_ex(request->entrypoint, request->userdata, &request->options);
+	}
+	loop->head += len;
+	atomic_store_explicit(&loop->len, 0, memory_order_relaxed);
+	mtx_unlock(&loop->mtx);
+}
 
-					bio_signal_impl_t* signal = BIO_CONTAINER_OF(itr, bio_signal_impl_t, link);
-					bio_close_handle(signal->handle, &BIO_SIGNAL_HANDLE);
-					bio_free(signal);
+static bool
+bio_scheduler_steal_remote_requests(void) {
+	bio_spawn_request_t stolen[BIO_DEFAULT_LOOP_STEAL_BATCH_SIZE];
+	uint32_t num_stolen = 0;
 
-					itr = next;
-				}
+	mtx_lock(&bio_stealing_registry_mtx);
+	for (
+		bio_loop_link_t* itr = bio_stealing_registry.next;
+		itr != &bio_stealing_registry && num_stolen == 0;
+		itr = itr->next
+	) {
+		bio_loop_impl_t* victim = BIO_CONTAINER_OF(itr, bio_loop_impl_t, stealing_link);
+		if (victim == bio_ctx.loop_impl || atomic_load(&victim->len) == 0) {
+			continue;
+		}
 
-				// Trigger all monitors
-				for (
-					bio_monitor_link_t* itr = coro->monitors.next;
-					itr != &coro->monitors;
-				) {
-					bio_monitor_link_t* next = itr->next;
+		// Take the oldest half so both loops can make progress
+		mtx_lock(&victim->mtx);
+		uint32_t len = atomic_load_explicit(&victim->len, memory_order_relaxed);
+		num_stolen = (len + 1) / 2;
+		if (num_stolen > BIO_DEFAULT_LOOP_STEAL_BATCH_SIZE) {
+			num_stolen = BIO_DEFAULT_LOOP_STEAL_BATCH_SIZE;
+		}
+		for (uint32_t i = 0; i < num_stolen; ++i) {
+			stolen[i] = victim->requests[(victim->head + i) & (victim->capacity - 1)];
+		}
+		victim->head += num_stolen;
+		atomic_store_explicit(&victim->len, len - num_stolen, memory_order_relaxed);
+		mtx_unlock(&victim->mtx);
+	}
+	mtx_unlock(&bio_stealing_registry_mtx);
+
+	// Spawn outside of the locks
+	for (uint32_t i = 0; i < num_stolen; ++i) {
+		bio_spawn_ex(stolen[i].entrypoint, stolen[i].userdata, &stolen[i].options);
+	}
 
-					bio_monitor_impl_t* monitor = BIO_CONTAINER_OF(itr, bio_monitor_impl_t, link);
-					bio_raise_signal(monitor->signal);
-					bio_close_handle(monitor->handle, &BIO_MONITOR_HANDLE);
-					bio_free(monitor);
+	return num_stolen > 0;
+}
 
-					itr = next;
-				}
+static void
+bio_scheduler_wake_idle_loop(bio_loop_impl_t* busy_loop) {
+	mtx_lock(&bio_stealing_registry_mtx);
+	for (
+		bio_loop_link_t* itr = bio_stealing_registry.next;
+		itr != &bio_stealing_registry;
+		itr = itr->next
+	) {
+		// A registered loop has not started cleaning up so it can be notified
+		bio_loop_impl_t* loop = BIO_CONTAINER_OF(itr, bio_loop_impl_t, stealing_link);
+		// Clear the flag so concurrent spawns would wake up different loops
+		if (loop != busy_loop && atomic_exchange(&loop->is_idle, false)) {
+			bio_platform_notify(loop->platform);
+			break;
+		}
+	}
+	mtx_unlock(&bio_stealing_registry_mtx);
+}
+
+bio_loop_t
+bio_current_loop(void) {
+	bio_loop_impl_t* loop = bio_ctx.loop_impl;
+	if (loop == NULL) {
+		uint32_t capacity = bio_ctx.options.loop.inbox_size > 0
+			? (uint32_t)bio_ctx.options.loop.inbox_size
+			: BIO_DEFAULT_LOOP_INBOX_SIZE;
+		capacity = bio_next_pow2(capacity);
+		bio_ctx.options.loop.inbox_size = (int)capacity;
+
+		loop = bio_malloc(sizeof(bio_loop_impl_t));
+		*loop = (bio_loop_impl_t){
+			.requests = bio_malloc(sizeof(bio_spawn_request_t) * capacity),
+			.capacity = capacity,
+			.platform = &bio_ctx.platform,
+		};
+		// Owned by this loop until it terminates
+		atomic_store(&loop->ref_count, 1);
+		mtx_init(&loop->mtx, mtx_plain);
+		atomic_store(&loop->len, 0);
+		atomic_store(&loop->is_stealing, false);
+		atomic_store(&loop->is_idle, false);
+		bio_ctx.loop_impl = loop;
+
+		if (bio_ctx.options.loop.spawn_stealing) {
+			call_once(&bio_stealing_registry_once, bio_stealing_registry_init);
+			mtx_lock(&bio_stealing_registry_mtx);
+			BIO_LIST_APPEND(&bio_stealing_registry, &loop->stealing_link);
+			mtx_unlock(&bio_stealing_registry_mtx);
+			atomic_store(&loop->is_stealing, true);
+		}
+	}
+
+	atomic_fetch_add_explicit(&loop->ref_count, 1, memory_order_relaxed);
+	return (bio_loop_t){ .ctx = loop };
+}
+
+void
+bio_release_loop(bio_loop_t loop) {
+	bio_loop_impl_t* impl = loop.ctx;
+	if (impl == NULL) { return; }
+
+	if (atomic_fetch_sub_explicit(&impl->ref_count, 1, memory_order_acq_rel) == 1) {
+		mtx_destroy(&impl->mtx);
+		bio_free(impl);
+	}
+}
+
+bool
+bio_spawn_on(
+	bio_loop_t loop,
+	bio_entrypoint_t entrypoint,
+	void* userdata,
+	const bio_coro_options_t* options
+) {
+	bio_loop_impl_t* impl = loop.ctx;
+	if (BIO_LIKELY(impl != NULL)) {
+		if (impl == bio_ctx.loop_impl) {
+			bio_spawn_ex(entrypoint, userdata, options);
+			return true;
+		}
+
+		mtx_lock(&impl->mtx);
+		uint32_t len = atomic_load_explicit(&impl->len, memory_order_relaxed);
+		bool accepted = !impl->closed && len < impl->capacity;
+		bool should_wake_idle_loop = false;
+		if (accepted) {
+			impl->requests[(impl->head + len) & (impl->capacity - 1)] = (bio_spawn_request_t){
+				.entrypoint = entrypoint,
+				.userdata = userdata,
+				.options = options != NULL ? *options : (bio_coro_options_t){ 0 },
+			};
+			atomic_store(&impl->len, len + 1);
+
+			// Only the first request needs to wake the loop up.
+			// The platform is only valid until the loop is closed.
+			if (len == 0) {
+				bio_platform_notify(impl->platform);
+			}
+
+			// If the target is busy running coroutines, let an idle loop take over
+			should_wake_idle_loop = atomic_load(&impl->is_stealing)
+				&& !atomic_load(&impl->is_idle);
+		}
+		mtx_unlock(&impl->mtx);
+
+		if (should_wake_idle_loop) {
+			bio_scheduler_wake_idle_loop(impl);
+		}
+
+		return accepted;
+	} else {
+		return false;
+	}
+}
+
+static bio_coro_pool_bucket_t*
+bio_coro_pool_bucket(size_t coro_size) {
+	// There are typically only a few distinct stack sizes
+	size_t num_buckets = bio_array_len(bio_ctx.coro_pool);
+	for (size_t i = 0; i < num_buckets; ++i) {
+		if (bio_ctx.coro_pool[i].coro_size == coro_size) {
+			return &bio_ctx.coro_pool[i];
+		}
+	}
+
+	bio_coro_pool_bucket_t bucket = { .coro_size = coro_size };
+	bio_array_push(bio_ctx.coro_pool, bucket);
+	return &bio_ctx.coro_pool[num_buckets];
+}
+
+static void
+bio_coro_release(bio_coro_impl_t* coro) {
+	int max_idle_coros = bio_ctx.options.coro_pool.max_idle_coros;
+	if (max_idle_coros > 0) {
+		bio_coro_pool_bucket_t* bucket = bio_coro_pool_bucket(coro->impl->coro_size);
+		if (bio_array_len(bucket->idle_coros) < (size_t)max_idle_coros) {
+			mco_uninit(coro->impl);
+			bio_array_push(bucket->idle_coros, coro);
+			return;
+		}
+	}
+
+	mco_destroy(coro->impl);
+	bio_free(coro);
+}
+
+static bio_coro_impl_t*
+bio_coro_acquire(mco_desc* desc) {
+	if (bio_ctx.options.coro_pool.max_idle_coros > 0) {
+		bio_coro_pool_bucket_t* bucket = bio_coro_pool_bucket(desc->coro_size);
+		if (bio_array_len(bucket->idle_coros) > 0) {
+			bio_coro_impl_t* coro = bio_array_pop(bucket->idle_coros);
+			desc->user_data = coro;
+			mco_init(coro->impl, desc);
+			return coro;
+		}
+	}
+
+	bio_coro_impl_t* coro = bio_malloc(sizeof(bio_coro_impl_t));
+	desc->user_data = coro;
+	mco_create(&coro->impl, desc);
+	return coro;
+}
+
+// Returns NULL if the data is too big for any slab
+static bio_slab_t*
+bio_cls_slab(size_t size) {
+	size_t item_size = BIO_MIN_CLS_SLAB_ITEM_SIZE;
+	for (int i = 0; i < BIO_NUM_CLS_SLABS; ++i, item_size *= 2) {
+		if (size <= item_size) { return &bio_ctx.cls_slabs[i]; }
+	}
+	return NULL;
+}
+
+static void
+bio_cleanup_cls(bio_cls_slot_t* slot) {
+	const bio_cls_t* cls = slot->spec;
+	if (cls->cleanup != NULL) { cls->cleanup(slot->data); }
+
+	bio_slab_t* slab = bio_cls_slab(cls->size);
+	if (slab != NULL) {
+		bio_slab_free(slab, slot->data);
+	} else {
+		bio_free(slot->data);
+	}
+}
+
+static void
+bio_coro_destroy(bio_coro_impl_t* coro) {
+	// Cleanup all CLS
+	for (int i = 0; i < BIO_NUM_INLINE_CLS && coro->inline_cls[i].spec != NULL; ++i) {
+		bio_cleanup_cls(&coro->inline_cls[i]);
+	}
+	for (int32_t i = 0; i < coro->cls_capacity; ++i) {
+		if (coro->cls_slots[i].spec != NULL) {
+			bio_cleanup_cls(&coro->cls_slots[i]);
+		}
+	}
+	bio_free(coro->cls_slots);
+
+	// Destroy all signals
+	for (
+		bio_signal_link_t* itr = coro->pending_signals.next;
+		itr != &coro->pending_signals;
+	) {
+		bio_signal_link_t* next = itr->next;
 
-				// Destroy the coroutine
-				mco_destroy(coro->impl);
-				bio_close_handle(coro->handle, &BIO_CORO_HANDLE);
-				--bio_ctx.num_coros;
-				if (coro->daemon) {
-					--bio_ctx.num_daemons;
+		bio_signal_impl_t* signal = BIO_CONTAINER_OF(itr, bio_signal_impl_t, link);
+		bio_close_handle(signal->handle, &BIO_SIGNAL_HANDLE);
+		bio_slab_free(&bio_ctx.signal_slab, signal);
+
+		itr = next;
+	}
+
+	// Trigger all monitors
+	for (
+		bio_monitor_link_t* itr = coro->monitors.next;
+		itr != &coro->monitors;
+	) {
+		bio_monitor_link_t* next = itr->next;
+
+		bio_monitor_impl_t* monitor = BIO_CONTAINER_OF(itr, bio_monitor_impl_t, link);
+		bio_raise_signal(monitor->signal);
+		bio_close_handle(monitor->handle, &BIO_MONITOR_HANDLE);
+		bio_slab_free(&bio_ctx.monitor_slab, monitor);
+
+		itr = next;
+	}
+
+	// Destroy the coroutine
+	bio_close_handle(coro->handle, &BIO_CORO_HANDLE);
+	--bio_ctx.num_coros;
+	if (coro->daemon) {
+		--bio_ctx.num_daemons;
+	}
+	bio_coro_release(coro);
+}
+
+static void
+bio_coro_add_stats(bio_coro_impl_t* coro, uint64_t num_resumes, int64_t run_time_ns, int64_t wait_time_ns) {
+	coro->stats.num_resumes += num_resumes;
+	coro->stats.run_time_ns += run_time_ns;
+	coro->stats.wait_time_ns += wait_time_ns;
+
+	if (coro->name_stats_index >= 0) {
+		bio_coro_stats_t* name_stats = &bio_ctx.coro_name_stats[coro->name_stats_index].stats;
+		name_stats->num_resumes += num_resumes;
+		name_stats->run_time_ns += run_time_ns;
+		name_stats->wait_time_ns += wait_time_ns;
+	}
+}
+
+static void
+bio_coro_run(bio_coro_impl_t* coro) {
+	bool collect_stats = bio_ctx.options.scheduler.collect_coro_stats;
+	int64_t start_time_ns = collect_stats ? bio_platform_current_time_ns() : 0;
+
+	coro->state = BIO_CORO_RUNNING;
+	coro->num_blocking_signals = 0;
+	if (bio_ctx.trace != NULL) { bio_trace_coro_event(BIO_TRACE_RESUME, coro); }
+	mco_resume(coro->impl);
+
+	if (collect_stats) {
+		int64_t end_time_ns = bio_platform_current_time_ns();
+		bio_coro_add_stats(coro, 1, end_time_ns - start_time_ns, 0);
+		coro->wait_start_ns = end_time_ns;
+	}
+
+	if (mco_status(coro->impl) != MCO_DEAD) {
+		bool waiting = coro->num_blocking_signals > 0;
+		if (bio_ctx.trace != NULL) {
+			bio_trace_coro_event(waiting ? BIO_TRACE_WAIT : BIO_TRACE_YIELD, coro);
+		}
+		coro->state = waiting ? BIO_CORO_WAITING : BIO_CORO_READY;
+		if (!waiting) {
+			bio_schedule_coro(coro);
+		}
+	} else {
+		if (bio_ctx.trace != NULL) { bio_trace_coro_event(BIO_TRACE_EXIT, coro); }
+		bio_coro_destroy(coro);
+	}
+}
+
+// Reap completions in the middle of a long run so they are not delayed until
+// every ready coroutine has been resumed
+static void
+bio_scheduler_poll_within_budget(void) {
+	int max_resumes = bio_ctx.options.scheduler.max_resumes_per_poll;
+	if (max_resumes > 0 && ++bio_ctx.num_resumes_since_poll >= max_resumes) {
+		bio_thread_update();
+		bio_timer_poll();
+		bio_platform_update(0, bio_num_running_async_jobs() > 0 || bio_ctx.loop_impl != NULL);
+		bio_ctx.num_resumes_since_poll = 0;
+	}
+}
+
+static bool
+bio_has_ready_coros(void) {
+	for (int priority = 0; priority < BIO_NUM_CORO_PRIORITIES; ++priority) {
+		if (bio_array_len(bio_ctx.next_ready_coros[priority]) > 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+bio_loop(void) {
+	while (true) {
+		// Pop and run coros off the current lists until they are empty.
+		// Higher priority lists are run first.
+		for (int priority = 0; priority < BIO_NUM_CORO_PRIORITIES; ++priority) {
+			BIO_ARRAY(bio_coro_impl_t*) ready_coros = bio_ctx.current_ready_coros[priority];
+			int num_coros = (int)bio_array_len(ready_coros);
+			for (int coro_index = 0; coro_index < num_coros; ++coro_index) {
+				bio_ctx.num_lifo_runs = 0;
+				bio_coro_run(ready_coros[coro_index]);
+				bio_scheduler_poll_within_budget();
+
+				// Each wake up chain shares the turn of the coroutine that
+				// started it.
+				// The chain is cut after a limit so a pair of coroutines
+				// waking each other cannot starve the rest.
+				bio_coro_impl_t* lifo_coro;
+				while ((lifo_coro = bio_ctx.lifo_coro) != NULL) {
+					bio_ctx.lifo_coro = NULL;
+					++bio_ctx.num_lifo_runs;
+					bio_coro_run(lifo_coro);
+					bio_scheduler_poll_within_budget();
 				}
-				bio_free(coro);
 			}
+			bio_array_clear(ready_coros);
 		}
-		bio_array_clear(bio_ctx.current_ready_coros);
+
+		// Requests from other loops might keep this loop alive
+		bio_scheduler_drain_remote_requests();
 
 		bool should_terminate = bio_ctx.is_terminating
 			// During termination, run until there is no coroutines
 			? bio_ctx.num_coros == 0
 			// During normal operation, run until there is no non-daemon coroutines
-			: bio_ctx.num_coros == bio_ctx.num_daemons;
+			// and no timer left to fire
+			: bio_ctx.num_coros == bio_ctx.num_daemons && bio_ctx.num_active_timers == 0;
 		if (should_terminate) { break; }
 
 		// Poll async jobs
@@ -118,12 +562,48 @@ bio_loop(void) {
 		bio_timer_update();
 
 		// Perform I/O, wait if there is no ready coros
-		bool should_wait_for_io = bio_array_len(bio_ctx.next_ready_coros) == 0;
+		bool should_wait_for_io = !bio_has_ready_coros();
+
+		// Before going idle, try to take over some work from a busy loop.
+		// The flag is raised first so that a concurrent bio_spawn_on would
+		// either see it and wake this loop or have its request stolen here.
+		bio_loop_impl_t* loop = bio_ctx.loop_impl;
+		bool is_stealing = loop != NULL
+			&& atomic_load_explicit(&loop->is_stealing, memory_order_relaxed)
+			&& !bio_ctx.is_terminating;
+		if (should_wait_for_io && is_stealing) {
+			atomic_store(&loop->is_idle, true);
+			if (bio_scheduler_steal_remote_requests()) {
+				should_wait_for_io = false;
+				atomic_store(&loop->is_idle, false);
+			}
+		}
+
+		bio_time_t wait_timeout_us = 0;
+		if (should_wait_for_io) {
+			wait_timeout_us = bio_time_until_next_timer_us();
+
+			// Wake up to check on jobs waiting for a thread
+			bio_time_t resize_timeout_us = bio_thread_time_until_resize_us();
+			if (
+				resize_timeout_us >= 0
+				&& (wait_timeout_us < 0 || resize_timeout_us < wait_timeout_us)
+			) {
+				wait_timeout_us = resize_timeout_us;
+			}
+		}
+
 		bio_platform_update(
-			should_wait_for_io ? bio_time_until_next_timer() : 0,
-			bio_num_running_async_jobs() > 0
+			wait_timeout_us,
+			bio_num_running_async_jobs() > 0 || bio_ctx.loop_impl != NULL
 		);
 
+		bio_ctx.num_resumes_since_poll = 0;
+
+		if (is_stealing) {
+			atomic_store(&loop->is_idle, false);
+		}
+
 		// Some async tasks or timer might have completed during the long wait
 		if (should_wait_for_io) {
 			bio_thread_update();
@@ -131,9 +611,11 @@ bio_loop(void) {
 		}
 
 		// Swap the coro lists
-		BIO_ARRAY(bio_coro_impl_t*) tmp = bio_ctx.next_ready_coros;
-		bio_ctx.next_ready_coros = bio_ctx.current_ready_coros;
-		bio_ctx.current_ready_coros = tmp;
+		for (int priority = 0; priority < BIO_NUM_CORO_PRIORITIES; ++priority) {
+			BIO_ARRAY(bio_coro_impl_t*) tmp = bio_ctx.next_ready_coros[priority];
+			bio_ctx.next_ready_coros[priority] = bio_ctx.current_ready_coros[priority];
+			bio_ctx.current_ready_coros[priority] = tmp;
+		}
 	}
 }
 
@@ -153,23 +635,23 @@ bio_spawn_ex(
 		options = &(bio_coro_options_t){ 0 };
 	}
 
-	bio_coro_impl_t* coro = bio_malloc(sizeof(bio_coro_impl_t));
+	mco_desc desc = mco_desc_init(bio_coro_entry_wrapper, options->stack_size);
+	bio_coro_impl_t* coro = bio_coro_acquire(&desc);
 	*coro = (bio_coro_impl_t){
+		.impl = coro->impl,
 		.entrypoint = entrypoint,
 		.userdata = userdata,
 		.state = BIO_CORO_READY,
 		.daemon = options->daemon,
+		.priority = bio_coro_priority_index(options->priority),
+		.name_stats_index = -1,
 	};
 	BIO_LIST_INIT(&coro->pending_signals);
 	BIO_LIST_INIT(&coro->monitors);
 
-	mco_desc desc = mco_desc_init(bio_coro_entry_wrapper, options->stack_size);
-	desc.user_data = coro;
-	mco_create(&coro->impl, &desc);
-
 	coro->handle = bio_make_handle(coro, &BIO_CORO_HANDLE);
 
-	bio_array_push(bio_ctx.next_ready_coros, coro);
+	bio_schedule_coro(coro);
 	if (++bio_ctx.num_coros == 1) {
 		bio_timer_update();
 	}
@@ -212,7 +694,7 @@ bio_make_signal(void) {
 	if (BIO_LIKELY(coro_impl != NULL)) {
 		bio_coro_impl_t* coro = coro_impl->user_data;
 
-		bio_signal_impl_t* signal = bio_malloc(sizeof(bio_signal_impl_t));
+		bio_signal_impl_t* signal = bio_slab_alloc(&bio_ctx.signal_slab);
 		*signal = (bio_signal_impl_t){
 			.owner = coro,
 			.wait_counter = coro->wait_counter - 1,
@@ -226,32 +708,69 @@ bio_make_signal(void) {
 	}
 }
 
+static bool
+bio_unblock_coro(bio_coro_impl_t* owner, int wait_counter) {
+	if (
+		owner->state == BIO_CORO_WAITING
+		&& wait_counter == owner->wait_counter
+		&& --owner->num_blocking_signals == 0  // Schedule to run once
+	) {
+		if (bio_ctx.options.scheduler.collect_coro_stats) {
+			int64_t wait_time_ns = bio_platform_current_time_ns() - owner->wait_start_ns;
+			bio_coro_add_stats(owner, 0, 0, wait_time_ns);
+		}
+		if (bio_ctx.trace != NULL) { bio_trace_coro_event(BIO_TRACE_RAISE, owner); }
+		bio_schedule_woken_coro(owner);
+		owner->state = BIO_CORO_READY;
+		return true;
+	} else {
+		return false;
+	}
+}
+
 bool
 bio_raise_signal(bio_signal_t ref) {
 	bool owner_waken_up = false;
 
 	bio_signal_impl_t* signal = bio_close_handle(ref.handle, &BIO_SIGNAL_HANDLE);
 	if (BIO_LIKELY(signal != NULL)) {
-		bio_coro_impl_t* owner = signal->owner;
-
-		if (
-			owner->state == BIO_CORO_WAITING
-			&& signal->wait_counter == owner->wait_counter
-		) {
-			if (--owner->num_blocking_signals == 0) {  // Schedule to run once
-				bio_array_push(bio_ctx.next_ready_coros, owner);
-				owner->state = BIO_CORO_READY;
-				owner_waken_up = true;
-			}
-		}
+		owner_waken_up = bio_unblock_coro(signal->owner, signal->wait_counter);
 
 		BIO_LIST_REMOVE(&signal->link);
-		bio_free(signal);
+		bio_slab_free(&bio_ctx.signal_slab, signal);
 	}
 
 	return owner_waken_up;
 }
 
+void
+bio_prepare_waiter(bio_waiter_t* waiter) {
+	mco_coro* impl = mco_running();
+	*waiter = (bio_waiter_t){
+		.owner = impl != NULL ? impl->user_data : NULL,
+	};
+}
+
+void
+bio_wait_for_waiter(bio_waiter_t* waiter) {
+	bio_coro_impl_t* coro = waiter->owner;
+	if (BIO_LIKELY(coro != NULL && !waiter->raised)) {
+		waiter->wait_counter = ++coro->wait_counter;
+		coro->num_blocking_signals = 1;
+		mco_yield(coro->impl);
+	}
+}
+
+bool
+bio_raise_waiter(bio_waiter_t* waiter) {
+	if (BIO_LIKELY(!waiter->raised && waiter->owner != NULL)) {
+		waiter->raised = true;
+		return bio_unblock_coro(waiter->owner, waiter->wait_counter);
+	} else {
+		return false;
+	}
+}
+
 bool
 bio_check_signal(bio_signal_t ref) {
 	bio_signal_t* signal = bio_resolve_handle(ref.handle, &BIO_SIGNAL_HANDLE);
@@ -272,18 +791,29 @@ bio_wait_for_signals(
 		int wait_counter = ++coro->wait_counter;
 		int num_blocking_signals = 0;
 		bool signal_raised = false;
-		for (int i = 0; i < num_signals; ++i) {
-			bio_handle_t handle = signals[i].handle;
-			bio_signal_impl_t* signal = bio_resolve_handle(handle, &BIO_SIGNAL_HANDLE);
-
-			if (BIO_LIKELY(signal != NULL)) {
-				if (signal->owner == coro) {
-					signal->wait_counter = wait_counter;
-					++num_blocking_signals;
+		for (int batch_start = 0; batch_start < num_signals; batch_start += BIO_SIGNAL_BATCH_SIZE) {
+			int batch_size = num_signals - batch_start;
+			if (batch_size > BIO_SIGNAL_BATCH_SIZE) { batch_size = BIO_SIGNAL_BATCH_SIZE; }
+
+			void* impls[BIO_SIGNAL_BATCH_SIZE];
+			bio_resolve_handles(
+				&signals[batch_start].handle, batch_size,
+				&BIO_SIGNAL_HANDLE,
+				impls
+			);
+
+			for (int i = 0; i < batch_size; ++i) {
+				bio_signal_impl_t* signal = impls[i];
+				if (BIO_LIKELY(signal != NULL)) {
+					if (signal->owner == coro) {
+						signal->wait_counter = wait_counter;
+						++num_blocking_signals;
+					}
+				} else {
+					// Only non-zero signals are considered raised
+					bio_handle_t handle = signals[batch_start + i].handle;
+					signal_raised |= bio_handle_compare(handle, BIO_INVALID_HANDLE) != 0;
 				}
-			} else {
-				// Only non-zero signals are considered raised
-				signal_raised |= bio_handle_compare(handle, BIO_INVALID_HANDLE) != 0;
 			}
 		}
 
@@ -305,7 +835,7 @@ bio_monitor(bio_coro_t coro, bio_signal_t signal) {
 			&& signal_impl->owner != coro_impl
 		)
 	) {
-		bio_monitor_impl_t* monitor = bio_malloc(sizeof(bio_monitor_impl_t));
+		bio_monitor_impl_t* monitor = bio_slab_alloc(&bio_ctx.monitor_slab);
 		*monitor = (bio_monitor_impl_t){ .signal = signal };
 		monitor->handle = bio_make_handle(monitor, &BIO_MONITOR_HANDLE);
 		BIO_LIST_APPEND(&coro_impl->monitors, &monitor->link);
@@ -321,7 +851,7 @@ bio_unmonitor(bio_monitor_t ref) {
 	bio_monitor_impl_t* monitor = bio_close_handle(ref.handle, &BIO_MONITOR_HANDLE);
 	if (BIO_LIKELY(monitor != NULL)) {
 		BIO_LIST_REMOVE(&monitor->link);
-		bio_free(monitor);
+		bio_slab_free(&bio_ctx.monitor_slab, monitor);
 	}
 }
 
@@ -345,12 +875,34 @@ bio_get_coro_data(bio_coro_t coro, const bio_tag_t* tag) {
 	}
 }
 
+static int32_t
+bio_coro_name_stats_index(const char* name) {
+	if (name == NULL) { return -1; }
+
+	int32_t num_entries = (int32_t)bio_array_len(bio_ctx.coro_name_stats);
+	for (int32_t i = 0; i < num_entries; ++i) {
+		if (strcmp(bio_ctx.coro_name_stats[i].name, name) == 0) {
+			return i;
+		}
+	}
+
+	// The name is copied since the string may not outlive the coroutine
+	size_t name_len = strlen(name);
+	bio_coro_name_stats_t entry = { .name = bio_malloc(name_len + 1) };
+	memcpy(entry.name, name, name_len + 1);
+	bio_array_push(bio_ctx.coro_name_stats, entry);
+	return num_entries;
+}
+
 void
 bio_set_coro_name(const char* name) {
 	mco_coro* impl = mco_running();
 	if (BIO_LIKELY(impl)) {
 		bio_coro_impl_t* coro = impl->user_data;
 		coro->name = name;
+		if (bio_ctx.options.scheduler.collect_coro_stats) {
+			coro->name_stats_index = bio_coro_name_stats_index(name);
+		}
 	}
 }
 
@@ -364,6 +916,34 @@ bio_get_coro_name(bio_coro_t coro) {
 	}
 }
 
+bool
+bio_get_coro_stats(bio_coro_t coro, bio_coro_stats_t* stats) {
+	if (!bio_ctx.options.scheduler.collect_coro_stats) { return false; }
+
+	bio_coro_impl_t* coro_impl = bio_resolve_handle(coro.handle, &BIO_CORO_HANDLE);
+	if (BIO_LIKELY(coro_impl != NULL)) {
+		*stats = coro_impl->stats;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+bool
+bio_get_coro_stats_by_name(const char* name, bio_coro_stats_t* stats) {
+	if (!bio_ctx.options.scheduler.collect_coro_stats || name == NULL) { return false; }
+
+	size_t num_entries = bio_array_len(bio_ctx.coro_name_stats);
+	for (size_t i = 0; i < num_entries; ++i) {
+		if (strcmp(bio_ctx.coro_name_stats[i].name, name) == 0) {
+			*stats = bio_ctx.coro_name_stats[i].stats;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 // https://nullprogram.com/blog/2018/07/31/
 static uint64_t
 bio_splittable64(uint64_t x) {
@@ -375,37 +955,73 @@ bio_splittable64(uint64_t x) {
 	return x;
 }
 
+static void*
+bio_init_cls(bio_cls_slot_t* slot, const bio_cls_t* cls) {
+	slot->spec = cls;
+	// The data must not move when the table grows so it lives outside of it
+	bio_slab_t* slab = bio_cls_slab(cls->size);
+	void* data = slab != NULL ? bio_slab_alloc(slab) : bio_malloc(cls->size);
+	slot->data = data;
+	// init may get other CLS and grow the table so slot must not be touched
+	// afterwards
+	if (cls->init != NULL) { cls->init(data); }
+	return data;
+}
+
+static bio_cls_slot_t*
+bio_find_cls_slot(bio_cls_slot_t* slots, int32_t capacity, const bio_cls_t* cls) {
+	uint64_t mask = (uint64_t)capacity - 1;
+	uint64_t index = bio_splittable64((uint64_t)(uintptr_t)cls) & mask;
+	// The table is never full so this always stops at an empty slot
+	while (slots[index].spec != NULL && slots[index].spec != cls) {
+		index = (index + 1) & mask;
+	}
+	return &slots[index];
+}
+
+static void
+bio_grow_cls_table(bio_coro_impl_t* coro) {
+	int32_t old_capacity = coro->cls_capacity;
+	bio_cls_slot_t* old_slots = coro->cls_slots;
+
+	int32_t new_capacity = old_capacity > 0 ? old_capacity * 2 : bio_ctx.options.num_cls_buckets;
+	bio_cls_slot_t* new_slots = bio_malloc(sizeof(bio_cls_slot_t) * new_capacity);
+	memset(new_slots, 0, sizeof(bio_cls_slot_t) * new_capacity);
+	for (int32_t i = 0; i < old_capacity; ++i) {
+		if (old_slots[i].spec != NULL) {
+			*bio_find_cls_slot(new_slots, new_capacity, old_slots[i].spec) = old_slots[i];
+		}
+	}
+	bio_free(old_slots);
+
+	coro->cls_slots = new_slots;
+	coro->cls_capacity = new_capacity;
+}
+
 void*
 bio_get_cls(const bio_cls_t* cls) {
 	mco_coro* impl = mco_running();
 	if (BIO_LIKELY(impl)) {
 		bio_coro_impl_t* coro = impl->user_data;
 
-		int num_buckets = bio_ctx.options.num_cls_buckets;
-		bio_cls_link_t* buckets = coro->cls_buckets;
-		if (buckets == NULL) {
-			coro->cls_buckets = buckets = bio_malloc(sizeof(bio_cls_link_t) * num_buckets);
-			for (int i = 0; i < num_buckets; ++i) {
-				BIO_LIST_INIT(&buckets[i]);
-			}
+		// Inline slots are filled in order and never emptied
+		for (int i = 0; i < BIO_NUM_INLINE_CLS; ++i) {
+			bio_cls_slot_t* slot = &coro->inline_cls[i];
+			if (slot->spec == cls) { return slot->data; }
+			if (slot->spec == NULL) { return bio_init_cls(slot, cls); }
 		}
 
-		uint64_t hash = bio_splittable64((uint64_t)(uintptr_t)cls);
-		int bucket_index = (int)(hash & ((uint64_t)num_buckets - 1));
-		bio_cls_link_t* bucket = &buckets[bucket_index];
-
-		for (bio_cls_link_t* itr = bucket->next; itr != bucket; itr = itr->next) {
-			bio_cls_entry_t* entry = BIO_CONTAINER_OF(itr, bio_cls_entry_t, link);
-			if (entry->spec == cls) {
-				return entry->data;
-			}
+		if (coro->cls_capacity > 0) {
+			bio_cls_slot_t* slot = bio_find_cls_slot(coro->cls_slots, coro->cls_capacity, cls);
+			if (slot->spec == cls) { return slot->data; }
 		}
 
-		bio_cls_entry_t* new_entry = bio_malloc(sizeof(bio_cls_entry_t) + cls->size);
-		new_entry->spec = cls;
-		if (cls->init != NULL) { cls->init(new_entry->data); }
-		BIO_LIST_APPEND(bucket, &new_entry->link);
-		return new_entry->data;
+		// Keep the load factor at or below one half
+		while ((coro->num_cls + 1) * 2 > coro->cls_capacity) {
+			bio_grow_cls_table(coro);
+		}
+		++coro->num_cls;
+		return bio_init_cls(bio_find_cls_slot(coro->cls_slots, coro->cls_capacity, cls), cls);
 	} else {
 		return NULL;
 	}
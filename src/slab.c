@@ -0,0 +1,124 @@
+#include "internal.h"
+
+typedef struct {
+	bio_slab_chunk_link_t link;
+	bio_slab_chunk_link_t partial_link;
+
+	// Freed objects, linked through their data
+	struct bio_slab_item_s* free_items;
+	uint32_t capacity;
+	uint32_t num_used;
+	// Objects are carved out lazily so a new chunk is not touched all at once
+	uint32_t num_carved;
+
+	_Alignas(BIO_ALIGN_TYPE) char items[];
+} bio_slab_chunk_t;
+
+typedef struct bio_slab_item_s {
+	bio_slab_chunk_t* chunk;
+
+	_Alignas(BIO_ALIGN_TYPE) char data[];
+} bio_slab_item_t;
+
+static inline bio_slab_chunk_t*
+bio_slab_chunk_of_partial_link(bio_slab_chunk_link_t* link) {
+	return BIO_CONTAINER_OF(link, bio_slab_chunk_t, partial_link);
+}
+
+static void
+bio_slab_grow(bio_slab_t* slab) {
+	uint32_t capacity = slab->next_chunk_capacity;
+	bio_slab_chunk_t* chunk = bio_malloc(sizeof(bio_slab_chunk_t) + slab->item_stride * capacity);
+	*chunk = (bio_slab_chunk_t){ .capacity = capacity };
+	BIO_LIST_APPEND(&slab->chunks, &chunk->link);
+	// Empty chunks are at the back
+	BIO_LIST_APPEND(&slab->partial_chunks, &chunk->partial_link);
+	++slab->num_empty_chunks;
+
+	if (capacity < BIO_DEFAULT_SLAB_MAX_CHUNK_SIZE) {
+		slab->next_chunk_capacity = capacity * 2;
+	}
+}
+
+void
+bio_slab_init(bio_slab_t* slab, size_t item_size) {
+	size_t alignment = _Alignof(BIO_ALIGN_TYPE);
+	// The data of a free object holds the next pointer
+	if (item_size < sizeof(bio_slab_item_t*)) { item_size = sizeof(bio_slab_item_t*); }
+
+	*slab = (bio_slab_t){
+		.item_stride = sizeof(bio_slab_item_t) + (item_size + alignment - 1) / alignment * alignment,
+		.next_chunk_capacity = BIO_DEFAULT_SLAB_MIN_CHUNK_SIZE,
+	};
+	BIO_LIST_INIT(&slab->chunks);
+	BIO_LIST_INIT(&slab->partial_chunks);
+}
+
+void
+bio_slab_cleanup(bio_slab_t* slab) {
+	for (
+		bio_slab_chunk_link_t* itr = slab->chunks.next;
+		itr != &slab->chunks;
+	) {
+		bio_slab_chunk_link_t* next = itr->next;
+		bio_free(BIO_CONTAINER_OF(itr, bio_slab_chunk_t, link));
+		itr = next;
+	}
+
+	BIO_LIST_INIT(&slab->chunks);
+	BIO_LIST_INIT(&slab->partial_chunks);
+	slab->num_empty_chunks = 0;
+}
+
+void*
+bio_slab_alloc(bio_slab_t* slab) {
+	if (BIO_LIST_IS_EMPTY(&slab->partial_chunks)) {
+		bio_slab_grow(slab);
+	}
+
+	bio_slab_chunk_t* chunk = bio_slab_chunk_of_partial_link(slab->partial_chunks.next);
+	bio_slab_item_t* item = chunk->free_items;
+	if (item != NULL) {
+		chunk->free_items = *(bio_slab_item_t**)item->data;
+	} else {
+		item = (bio_slab_item_t*)(chunk->items + slab->item_stride * chunk->num_carved++);
+		item->chunk = chunk;
+	}
+
+	if (chunk->num_used++ == 0) {
+		--slab->num_empty_chunks;
+	}
+	if (chunk->num_used == chunk->capacity) {
+		BIO_LIST_REMOVE(&chunk->partial_link);
+	}
+
+	return item->data;
+}
+
+void
+bio_slab_free(bio_slab_t* slab, void* ptr) {
+	if (ptr == NULL) { return; }
+
+	bio_slab_item_t* item = (bio_slab_item_t*)((char*)ptr - offsetof(bio_slab_item_t, data));
+	bio_slab_chunk_t* chunk = item->chunk;
+	*(bio_slab_item_t**)item->data = chunk->free_items;
+	chunk->free_items = item;
+
+	if (chunk->num_used-- == chunk->capacity) {
+		// Partially used chunks are at the front so they fill up first
+		bio_slab_chunk_link_t* front = slab->partial_chunks.next;
+		BIO_LIST_APPEND(front, &chunk->partial_link);
+	}
+
+	if (chunk->num_used == 0) {
+		BIO_LIST_REMOVE(&chunk->partial_link);
+		if (slab->num_empty_chunks > 0) {
+			// Trim
+			BIO_LIST_REMOVE(&chunk->link);
+			bio_free(chunk);
+		} else {
+			BIO_LIST_APPEND(&slab->partial_chunks, &chunk->partial_link);
+			++slab->num_empty_chunks;
+		}
+	}
+}
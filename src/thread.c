@@ -4,298 +4,769 @@
 #include <limits.h>
 #include <string.h>
 
-typedef struct {
-	mtx_t mtx;
-	cnd_t cnd;
-} bio_thread_signal_t;
-
-typedef struct {
-	bio_thread_signal_t can_produce;
-	bio_thread_signal_t can_consume;
-	atomic_int count;
-	atomic_int head;
-	atomic_int tail;
-	void** values;
-	int size;
-} bio_spscq_t;
-
-struct bio_worker_thread_s {
-	thrd_t thread;
-	bio_spscq_t request_queue;
-	bio_spscq_t response_queue;
-	// We need a separate counter since the length of the queue is not reliable.
-	// If a worker has dequeued a job and is working on it, the queue would
-	// omit that count.
-	// There is no way to tell an idle worker from a busy one when both can
-	// have an empty queue.
-	unsigned int load;
-};
+// Upper bound of the number of CPUs when the affinity has to be queried
+#define BIO_MAX_CPUS 1024
 
 typedef enum {
-	BIO_WORKER_MSG_NOOP,
-	BIO_WORKER_MSG_TERMINATE,
-	BIO_WORKER_MSG_RUN,
-} bio_worker_msg_type_t;
+	BIO_STEAL_EMPTY,
+	BIO_STEAL_SUCCESS,
+	// Another thread took the job first, there may be more
+	BIO_STEAL_RETRY,
+} bio_steal_result_t;
+
+typedef struct bio_async_batch_s {
+	// Only the worker which finishes the last job reports the batch
+	atomic_int num_pending;
+	bio_signal_t signal;
+} bio_async_batch_t;
 
 typedef struct {
-	bio_worker_msg_type_t type;
-	bool need_notification;
+	bio_range_fn_t fn;
+	void* userdata;
+	size_t begin;
+	size_t end;
+} bio_parallel_for_chunk_t;
+
+typedef struct bio_job_buffer_s {
+	// The buffer this replaced.
+	// A thief may still be reading from it so it is only freed on cleanup.
+	struct bio_job_buffer_s* prev;
+	unsigned int capacity;
+	_Atomic(bio_async_job_t*) items[];
+} bio_job_buffer_t;
+
+// A Chase-Lev work-stealing deque.
+// Only the loop pushes at the bottom and it never pops so every worker,
+// including the owner, takes jobs from the top.
+// The indices are free running and only masked on access.
+typedef struct {
+	atomic_uint top;
+	atomic_uint bottom;
+	_Atomic(bio_job_buffer_t*) buffer;
+} bio_job_deque_t;
 
-	struct {
-		bio_entrypoint_t fn;
-		void* userdata;
-		bio_signal_t signal;
-	} run;
-} bio_worker_msg_t;
+typedef enum {
+	BIO_WORKER_STOPPED,
+	BIO_WORKER_RUNNING,
+	// The thread has exited but it is not joined yet
+	BIO_WORKER_RETIRED,
+} bio_worker_state_t;
 
+typedef struct {
+	thrd_t thread;
+	atomic_int state;
+	bio_thread_pool_t* pool;
+	int index;
+	// State of the random number generator used to pick a victim
+	uint32_t rng;
+
+	bio_job_deque_t jobs;
+} bio_worker_thread_t;
+
+struct bio_thread_pool_s {
+	// There is a slot for every thread the pool may have.
+	// A slot keeps its queue when its thread retires so there may still be jobs
+	// to steal from it.
+	bio_worker_thread_t* workers;
+	int max_workers;
+	int min_workers;
+	int idle_timeout_ms;
+	// Number of slots that were ever used
+	atomic_int num_slots;
+	// Number of threads which have not retired
+	atomic_int num_live_workers;
+	atomic_int num_retired_workers;
+
+	// The CPUs workers are restricted to
+	int* cpus;
+	int num_cpus;
+
+	// Only accessed by the loop
+	// Submission is round robin, stealing takes care of the imbalance
+	int next_worker;
+	// When jobs started waiting for a thread, -1 if they are not
+	bio_time_t saturated_since_us;
+	bio_time_t spawn_delay_us;
+
+	// Idle workers park on this.
+	// It is bumped whenever they should look for jobs again.
+	atomic_uint wake_epoch;
+	atomic_int num_sleepers;
+	atomic_bool stopping;
+
+	// Finished jobs pushed by all workers, newest first.
+	// The loop takes the whole list at once.
+	_Atomic(bio_async_job_t*) completed_jobs;
+
+	// The context is thread-local so the workers must keep a reference to the
+	// platform of the loop that owns them
+	bio_platform_t* platform;
+};
 
-static void
-bio_thread_signal_init(bio_thread_signal_t* signal) {
-	mtx_init(&signal->mtx, mtx_plain);
-	cnd_init(&signal->cnd);
+static bio_job_buffer_t*
+bio_job_buffer_alloc(unsigned int capacity) {
+	bio_job_buffer_t* buffer = bio_malloc(
+		sizeof(bio_job_buffer_t) + sizeof(_Atomic(bio_async_job_t*)) * capacity
+	);
+	buffer->prev = NULL;
+	buffer->capacity = capacity;
+	return buffer;
 }
 
 static void
-bio_thread_signal_cleanup(bio_thread_signal_t* signal) {
-	cnd_destroy(&signal->cnd);
-	mtx_destroy(&signal->mtx);
+bio_job_deque_init(bio_job_deque_t* deque, unsigned int capacity) {
+	atomic_store(&deque->top, 0);
+	atomic_store(&deque->bottom, 0);
+	atomic_store(&deque->buffer, bio_job_buffer_alloc(capacity));
 }
 
 static void
-bio_thread_signal_raise(bio_thread_signal_t* signal) {
-	mtx_lock(&signal->mtx);
-	cnd_signal(&signal->cnd);
-	mtx_unlock(&signal->mtx);
+bio_job_deque_cleanup(bio_job_deque_t* deque) {
+	bio_job_buffer_t* buffer = atomic_load(&deque->buffer);
+	while (buffer != NULL) {
+		bio_job_buffer_t* prev = buffer->prev;
+		bio_free(buffer);
+		buffer = prev;
+	}
 }
 
+// Only called from the loop.
+// All jobs are published at once.
 static void
-bio_spscq_init(bio_spscq_t* queue, unsigned int size) {
-	bio_thread_signal_init(&queue->can_produce);
-	bio_thread_signal_init(&queue->can_consume);
-	queue->values = bio_malloc(sizeof(void*) * size);
-	atomic_store(&queue->head, 0);
-	atomic_store(&queue->tail, 0);
-	atomic_store(&queue->count, 0);
-	queue->size = size;
+bio_job_deque_push(bio_job_deque_t* deque, bio_async_job_t* jobs, int num_jobs) {
+	unsigned int bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	unsigned int top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	bio_job_buffer_t* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+
+	if (bottom - top + (unsigned int)num_jobs > buffer->capacity) {
+		// Grow instead of making the loop wait for the workers
+		unsigned int capacity = buffer->capacity * 2;
+		while (bottom - top + (unsigned int)num_jobs > capacity) { capacity *= 2; }
+
+		bio_job_buffer_t* new_buffer = bio_job_buffer_alloc(capacity);
+		for (unsigned int i = top; i != bottom; ++i) {
+			atomic_store_explicit(
+				&new_buffer->items[i & (new_buffer->capacity - 1)],
+				atomic_load_explicit(&buffer->items[i & (buffer->capacity - 1)], memory_order_relaxed),
+				memory_order_relaxed
+			);
+		}
+		new_buffer->prev = buffer;
+		atomic_store_explicit(&deque->buffer, new_buffer, memory_order_release);
+		buffer = new_buffer;
+	}
+
+	for (int i = 0; i < num_jobs; ++i) {
+		atomic_store_explicit(
+			&buffer->items[(bottom + (unsigned int)i) & (buffer->capacity - 1)],
+			&jobs[i],
+			memory_order_relaxed
+		);
+	}
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, bottom + (unsigned int)num_jobs, memory_order_relaxed);
 }
 
-static void
-bio_spscq_cleanup(bio_spscq_t* queue) {
-	bio_free(queue->values);
-	bio_thread_signal_cleanup(&queue->can_consume);
-	bio_thread_signal_cleanup(&queue->can_produce);
+// Called from any worker
+static bio_steal_result_t
+bio_job_deque_steal(bio_job_deque_t* deque, bio_async_job_t** job) {
+	unsigned int top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	unsigned int bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+	if ((int)(bottom - top) <= 0) { return BIO_STEAL_EMPTY; }
+
+	bio_job_buffer_t* buffer = atomic_load_explicit(&deque->buffer, memory_order_acquire);
+	bio_async_job_t* item = atomic_load_explicit(
+		&buffer->items[top & (buffer->capacity - 1)],
+		memory_order_relaxed
+	);
+	if (!atomic_compare_exchange_strong_explicit(
+		&deque->top, &top, top + 1,
+		memory_order_seq_cst, memory_order_relaxed
+	)) {
+		return BIO_STEAL_RETRY;
+	}
+
+	*job = item;
+	return BIO_STEAL_SUCCESS;
 }
 
-static bool
-bio_spscq_produce(bio_spscq_t* queue, void* item, bool wait) {
-	if (atomic_load(&queue->count) == queue->size) {
-		if (!wait) { return false; }
+static bio_async_job_t*
+bio_worker_find_job(bio_worker_thread_t* self) {
+	bio_thread_pool_t* pool = self->pool;
+	int num_workers = atomic_load(&pool->num_slots);
 
-		mtx_lock(&queue->can_produce.mtx);
-		while (queue->count == queue->size) {
-			cnd_wait(&queue->can_produce.cnd, &queue->can_produce.mtx);
+	bool should_retry;
+	do {
+		should_retry = false;
+		bio_async_job_t* job;
+
+		// Own queue first
+		bio_steal_result_t result = bio_job_deque_steal(&self->jobs, &job);
+		if (result == BIO_STEAL_SUCCESS) { return job; }
+		should_retry = result == BIO_STEAL_RETRY;
+
+		// Then steal from the others, starting at a random one so that thieves
+		// do not all go after the same victim
+		self->rng ^= self->rng << 13;
+		self->rng ^= self->rng >> 17;
+		self->rng ^= self->rng << 5;
+		int start = (int)(self->rng % (uint32_t)num_workers);
+		for (int i = 0; i < num_workers; ++i) {
+			int victim_index = (start + i) % num_workers;
+			if (victim_index == self->index) { continue; }
+
+			result = bio_job_deque_steal(&pool->workers[victim_index].jobs, &job);
+			if (result == BIO_STEAL_SUCCESS) { return job; }
+			should_retry |= result == BIO_STEAL_RETRY;
 		}
-		mtx_unlock(&queue->can_produce.mtx);
+	} while (should_retry);
+
+	return NULL;
+}
+
+// Return the previous head of the completion list
+static bio_async_job_t*
+bio_push_completed_job(bio_thread_pool_t* pool, bio_async_job_t* job) {
+	bio_async_job_t* head = atomic_load_explicit(&pool->completed_jobs, memory_order_relaxed);
+	do {
+		job->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&pool->completed_jobs, &head, job,
+		memory_order_release, memory_order_relaxed
+	));
+
+	return head;
+}
+
+// Take all completed jobs in the order they were pushed
+static bio_async_job_t*
+bio_take_completed_jobs(bio_thread_pool_t* pool) {
+	if (atomic_load_explicit(&pool->completed_jobs, memory_order_relaxed) == NULL) {
+		return NULL;
 	}
 
-	unsigned int tail = atomic_fetch_add(&queue->tail, 1);
-	queue->values[tail & (queue->size - 1)] = item;
-	if (atomic_fetch_add(&queue->count, 1) == 0) {
-		bio_thread_signal_raise(&queue->can_consume);
+	bio_async_job_t* job = atomic_exchange_explicit(&pool->completed_jobs, NULL, memory_order_acquire);
+	bio_async_job_t* reversed = NULL;
+	while (job != NULL) {
+		bio_async_job_t* next = job->next;
+		job->next = reversed;
+		reversed = job;
+		job = next;
 	}
 
-	return true;
+	return reversed;
 }
 
-static void*
-bio_spscq_consume(bio_spscq_t* queue, bool wait) {
-	if (atomic_load(&queue->count) == 0) {
-		if (!wait) { return NULL; }
+static bool
+bio_worker_can_retire(bio_worker_thread_t* self) {
+	bio_thread_pool_t* pool = self->pool;
+	return atomic_load(&pool->num_live_workers) > pool->min_workers;
+}
 
-		mtx_lock(&queue->can_consume.mtx);
-		while (queue->count == 0) {
-			cnd_wait(&queue->can_consume.cnd, &queue->can_consume.mtx);
+static bool
+bio_worker_try_retire(bio_worker_thread_t* self) {
+	bio_thread_pool_t* pool = self->pool;
+	int num_live_workers = atomic_load(&pool->num_live_workers);
+	while (num_live_workers > pool->min_workers) {
+		if (atomic_compare_exchange_weak(
+			&pool->num_live_workers, &num_live_workers, num_live_workers - 1
+		)) {
+			// The loop joins the thread later
+			atomic_store(&self->state, BIO_WORKER_RETIRED);
+			atomic_fetch_add(&pool->num_retired_workers, 1);
+			return true;
 		}
-		mtx_unlock(&queue->can_consume.mtx);
-	}
-
-	unsigned int head = atomic_fetch_add(&queue->head, 1);
-	void* item = queue->values[head & (queue->size - 1)];
-	if (atomic_fetch_add(&queue->count, -1) == queue->size) {
-		bio_thread_signal_raise(&queue->can_produce);
 	}
 
-	return item;
+	return false;
 }
 
 static int
 bio_async_worker(void* userdata) {
 	bio_worker_thread_t* self = userdata;
+	bio_thread_pool_t* pool = self->pool;
+
+	if (pool->num_cpus > 0) {
+		bio_platform_set_thread_affinity(pool->cpus, pool->num_cpus);
+	}
+
+	while (true) {
+		bio_async_job_t* job = bio_worker_find_job(self);
+
+		if (job == NULL) {
+			// Announce the intention to sleep then look again.
+			// A submission either sees the sleeper and bumps the epoch or its
+			// job is found here.
+			unsigned int epoch = atomic_load(&pool->wake_epoch);
+			atomic_fetch_add(&pool->num_sleepers, 1);
+			job = bio_worker_find_job(self);
+			bool timed_out = false;
+			if (job == NULL) {
+				if (atomic_load(&pool->stopping)) {
+					atomic_fetch_sub(&pool->num_sleepers, 1);
+					break;
+				}
+
+				timed_out = !bio_platform_futex_wait(
+					&pool->wake_epoch, epoch,
+					bio_worker_can_retire(self) ? pool->idle_timeout_ms : -1
+				);
+			}
+			atomic_fetch_sub(&pool->num_sleepers, 1);
+
+			if (job == NULL && timed_out) {
+				// A job might have been queued while this was not counted
+				// as a sleeper
+				job = bio_worker_find_job(self);
+				if (job == NULL && bio_worker_try_retire(self)) { break; }
+			}
 
-	bool running = true;
-	while (running) {
-		bio_worker_msg_t* msg = bio_spscq_consume(&self->request_queue, true);
-
-		switch (msg->type) {
-			case BIO_WORKER_MSG_NOOP:
-				break;
-			case BIO_WORKER_MSG_TERMINATE:
-				running = false;
-				break;
-			case BIO_WORKER_MSG_RUN:
-				msg->run.fn(msg->run.userdata);
-				break;
+			if (job == NULL) { continue; }
 		}
 
-		// If the scheduler is waiting for I/O, wake it up
-		// The condition hopefully introduces a dependency and ensure that
-		// notification is only sent after the queue message is published.
+		job->fn(job->userdata);
 
-		// Store the notification flag locally before sending the message.
-		// This is because the scheduler will free the message so accessing
-		// msg->need_notification after bio_spscq_produce is unsafe.
-		bool need_notification = msg->need_notification;
-		if (
-			bio_spscq_produce(&self->response_queue, msg, true)
-			&& need_notification
-		) {
-			bio_platform_notify();
+		bio_async_batch_t* batch = job->batch;
+		if (batch != NULL && atomic_fetch_sub(&batch->num_pending, 1) != 1) {
+			continue;
+		}
+
+		// Only the first completion of a batch needs to wake up the loop.
+		// The rest will be picked up in the same drain.
+		if (bio_push_completed_job(pool, job) == NULL) {
+			bio_platform_notify(pool->platform);
 		}
 	}
 
 	return 0;
 }
 
-void
-bio_thread_init(void) {
-	int num_threads = bio_ctx.options.thread_pool.num_threads;
-	if (num_threads <= 0) { num_threads = BIO_DEFAULT_THREAD_POOL_SIZE; }
+// Only called from the loop
+static void
+bio_thread_spawn_worker(bio_thread_pool_t* pool) {
+	for (int i = 0; i < pool->max_workers; ++i) {
+		bio_worker_thread_t* worker = &pool->workers[i];
+		if (atomic_load(&worker->state) != BIO_WORKER_STOPPED) { continue; }
+
+		atomic_store(&worker->state, BIO_WORKER_RUNNING);
+		atomic_fetch_add(&pool->num_live_workers, 1);
+		if (i >= atomic_load(&pool->num_slots)) {
+			atomic_store(&pool->num_slots, i + 1);
+		}
+
+		bio_platform_begin_create_thread_pool();
+		thrd_create(&worker->thread, bio_async_worker, worker);
+		bio_platform_end_create_thread_pool();
+		return;
+	}
+}
+
+static bool
+bio_thread_has_queued_jobs(bio_thread_pool_t* pool) {
+	int num_slots = atomic_load(&pool->num_slots);
+	for (int i = 0; i < num_slots; ++i) {
+		bio_job_deque_t* deque = &pool->workers[i].jobs;
+		unsigned int top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+		unsigned int bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+		if (bottom != top) { return true; }
+	}
+
+	return false;
+}
+
+// Join retired threads and start new ones when jobs have been waiting for too
+// long
+static void
+bio_thread_resize_pool(bio_thread_pool_t* pool) {
+	if (atomic_load_explicit(&pool->num_retired_workers, memory_order_relaxed) > 0) {
+		int num_slots = atomic_load(&pool->num_slots);
+		for (int i = 0; i < num_slots; ++i) {
+			bio_worker_thread_t* worker = &pool->workers[i];
+			if (atomic_load(&worker->state) == BIO_WORKER_RETIRED) {
+				thrd_join(worker->thread, NULL);
+				atomic_store(&worker->state, BIO_WORKER_STOPPED);
+				atomic_fetch_sub(&pool->num_retired_workers, 1);
+			}
+		}
+	}
+
+	if (pool->saturated_since_us < 0) { return; }
+
+	if (
+		atomic_load(&pool->num_live_workers) >= pool->max_workers
+		|| !bio_thread_has_queued_jobs(pool)
+	) {
+		pool->saturated_since_us = -1;
+		return;
+	}
+
+	bio_time_t current_time_us = bio_platform_current_time_ns() / 1000;
+	if (atomic_load(&pool->num_sleepers) > 0) {
+		// Some threads are about to take the jobs
+		pool->saturated_since_us = current_time_us;
+	} else if (current_time_us - pool->saturated_since_us >= pool->spawn_delay_us) {
+		bio_thread_spawn_worker(pool);
+		// Give the new thread some time before starting another one
+		pool->saturated_since_us = current_time_us;
+	}
+}
+
+static bio_thread_pool_t*
+bio_thread_pool_create(
+	bio_thread_pool_options_t* options,
+	int default_num_threads,
+	int default_max_threads
+) {
+	int num_threads = options->num_threads;
+	if (num_threads <= 0) { num_threads = default_num_threads; }
 
-	int queue_size = bio_ctx.options.thread_pool.queue_size;
+	int queue_size = options->queue_size;
 	if (queue_size <= 0) { queue_size = BIO_DEFAULT_THREAD_POOL_QUEUE_SIZE; }
 	queue_size = bio_next_pow2(queue_size);
 
-	bio_ctx.options.thread_pool.num_threads = num_threads;
-	bio_ctx.options.thread_pool.queue_size = queue_size;
+	int min_threads = options->min_threads;
+	if (min_threads <= 0 || min_threads > num_threads) { min_threads = num_threads; }
+
+	int max_threads = options->max_threads;
+	if (max_threads <= 0) { max_threads = default_max_threads; }
+	if (max_threads < num_threads) { max_threads = num_threads; }
+
+	int spawn_delay_ms = options->spawn_delay_ms;
+	if (spawn_delay_ms <= 0) { spawn_delay_ms = BIO_DEFAULT_THREAD_POOL_SPAWN_DELAY_MS; }
+
+	int idle_timeout_ms = options->idle_timeout_ms;
+	if (idle_timeout_ms <= 0) { idle_timeout_ms = BIO_DEFAULT_THREAD_POOL_IDLE_TIMEOUT_MS; }
+
+	options->num_threads = num_threads;
+	options->queue_size = queue_size;
+	options->min_threads = min_threads;
+	options->max_threads = max_threads;
+	options->spawn_delay_ms = spawn_delay_ms;
+	options->idle_timeout_ms = idle_timeout_ms;
+
+	bio_thread_pool_t* pool = bio_malloc(sizeof(bio_thread_pool_t));
+	*pool = (bio_thread_pool_t){
+		.workers = bio_malloc(max_threads * sizeof(bio_worker_thread_t)),
+		.max_workers = max_threads,
+		.min_workers = min_threads,
+		.idle_timeout_ms = idle_timeout_ms,
+		.saturated_since_us = -1,
+		.spawn_delay_us = (bio_time_t)spawn_delay_ms * 1000,
+		.platform = &bio_ctx.platform,
+	};
+	// Threads started later would otherwise inherit the affinity of the loop
+	int num_cpus = options->num_cpus;
+	if (num_cpus > 0) {
+		pool->cpus = bio_malloc(sizeof(int) * num_cpus);
+		memcpy(pool->cpus, options->cpus, sizeof(int) * num_cpus);
+		pool->num_cpus = num_cpus;
+	} else if (bio_ctx.options.loop.num_cpus > 0) {
+		pool->cpus = bio_malloc(sizeof(int) * BIO_MAX_CPUS);
+		pool->num_cpus = bio_platform_get_thread_affinity(pool->cpus, BIO_MAX_CPUS);
+	}
+	options->cpus = NULL;
+	options->num_cpus = 0;
+
+	atomic_store(&pool->num_slots, 0);
+	atomic_store(&pool->num_live_workers, 0);
+	atomic_store(&pool->num_retired_workers, 0);
+	atomic_store(&pool->wake_epoch, 0);
+	atomic_store(&pool->num_sleepers, 0);
+	atomic_store(&pool->stopping, false);
+	atomic_store(&pool->completed_jobs, NULL);
+
+	// Initialize all queues before any worker can steal from them
+	for (int i = 0; i < max_threads; ++i) {
+		bio_worker_thread_t* worker = &pool->workers[i];
+		*worker = (bio_worker_thread_t){
+			.pool = pool,
+			.index = i,
+			.rng = (uint32_t)i * 2654435761u + 1,
+		};
+		atomic_store(&worker->state, BIO_WORKER_STOPPED);
+		bio_job_deque_init(&worker->jobs, queue_size);
+	}
 
-	bio_worker_thread_t* workers = bio_malloc(num_threads * sizeof(bio_worker_thread_t));
-	memset(workers, 0, num_threads * sizeof(bio_worker_thread_t));
-	bio_platform_begin_create_thread_pool();
 	for (int i = 0; i < num_threads; ++i) {
-		bio_worker_thread_t* worker = &workers[i];
-		bio_spscq_init(&worker->request_queue, queue_size);
-		bio_spscq_init(&worker->response_queue, queue_size * 2);
-		thrd_create(&worker->thread, bio_async_worker, worker);
+		bio_thread_spawn_worker(pool);
+	}
+
+	return pool;
+}
+
+static void
+bio_thread_pool_destroy(bio_thread_pool_t* pool) {
+	atomic_store(&pool->stopping, true);
+	atomic_fetch_add(&pool->wake_epoch, 1);
+	bio_platform_futex_wake(&pool->wake_epoch, INT_MAX);
+
+	for (int i = 0; i < pool->max_workers; ++i) {
+		bio_worker_thread_t* worker = &pool->workers[i];
+		if (atomic_load(&worker->state) != BIO_WORKER_STOPPED) {
+			thrd_join(worker->thread, NULL);
+		}
+		bio_job_deque_cleanup(&worker->jobs);
+	}
+
+	bio_free(pool->cpus);
+	bio_free(pool->workers);
+	bio_free(pool);
+}
+
+void
+bio_thread_init(void) {
+	bio_ctx.thread_pools[BIO_ASYNC_COMPUTE] = bio_thread_pool_create(
+		&bio_ctx.options.thread_pool,
+		BIO_DEFAULT_THREAD_POOL_SIZE,
+		0
+	);
+	bio_ctx.thread_pools[BIO_ASYNC_BLOCKING] = bio_thread_pool_create(
+		&bio_ctx.options.blocking_pool,
+		BIO_DEFAULT_BLOCKING_POOL_SIZE,
+		BIO_DEFAULT_BLOCKING_POOL_MAX_SIZE
+	);
+
+	// This must come after the affinity of the workers was captured
+	bio_ctx.saved_loop_cpus = NULL;
+	bio_ctx.num_saved_loop_cpus = 0;
+	if (bio_ctx.options.loop.num_cpus > 0) {
+		int* saved_cpus = bio_malloc(sizeof(int) * BIO_MAX_CPUS);
+		int num_saved_cpus = bio_platform_get_thread_affinity(saved_cpus, BIO_MAX_CPUS);
+		if (
+			num_saved_cpus > 0
+			&& bio_platform_set_thread_affinity(bio_ctx.options.loop.cpus, bio_ctx.options.loop.num_cpus)
+		) {
+			bio_ctx.saved_loop_cpus = saved_cpus;
+			bio_ctx.num_saved_loop_cpus = num_saved_cpus;
+		} else {
+			// Nothing to restore if the affinity was not changed
+			bio_free(saved_cpus);
+		}
 	}
-	bio_platform_end_create_thread_pool();
-	bio_ctx.thread_pool = workers;
+	bio_ctx.options.loop.cpus = NULL;
+	bio_ctx.options.loop.num_cpus = 0;
 
 	bio_ctx.num_running_async_jobs = 0;
+	bio_slab_init(&bio_ctx.async_job_slab, sizeof(bio_async_job_t));
+	bio_slab_init(&bio_ctx.async_batch_slab, sizeof(bio_async_batch_t));
 }
 
 void
 bio_thread_cleanup(void) {
-	bio_worker_msg_t terminate = { .type = BIO_WORKER_MSG_TERMINATE };
-
-	int num_threads = bio_ctx.options.thread_pool.num_threads;
-	bio_worker_thread_t* workers = bio_ctx.thread_pool;
-	for (int i = 0; i < num_threads; ++i) {
-		bio_worker_thread_t* worker = &workers[i];
-
-		// Try to send the termination message
-		bio_worker_msg_t* msg;
-		while (!bio_spscq_produce(&worker->request_queue, &terminate, false)) {
-			// Either the response queue is full or the worker is busy so we
-			// wait for its first response
-			msg = bio_spscq_consume(&worker->response_queue, true);
-			while (msg != NULL) {
-				if (msg != &terminate) { bio_free(msg); }
-
-				// Drain as much as possible before retrying
-				msg = bio_spscq_consume(&worker->response_queue, false);
+	// Let the pending jobs finish
+	while (bio_ctx.num_running_async_jobs > 0) {
+		for (int i = 0; i < BIO_NUM_ASYNC_POOLS; ++i) {
+			bio_async_job_t* job = bio_take_completed_jobs(bio_ctx.thread_pools[i]);
+			while (job != NULL) {
+				bio_async_job_t* next = job->next;
+				bio_slab_free(&bio_ctx.async_batch_slab, job->batch);
+				if (job->pooled) { bio_slab_free(&bio_ctx.async_job_slab, job); }
+				--bio_ctx.num_running_async_jobs;
+				job = next;
 			}
 		}
 
-		// Drain and free messages from response queue
-		while ((msg = bio_spscq_consume(&worker->response_queue, false)) != NULL) {
-			if (msg != &terminate) { bio_free(msg); }
-		}
+		if (bio_ctx.num_running_async_jobs > 0) { thrd_yield(); }
+	}
 
-		thrd_join(worker->thread, NULL);
-		bio_spscq_cleanup(&worker->response_queue);
-		bio_spscq_cleanup(&worker->request_queue);
+	for (int i = 0; i < BIO_NUM_ASYNC_POOLS; ++i) {
+		bio_thread_pool_destroy(bio_ctx.thread_pools[i]);
 	}
 
-	bio_free(bio_ctx.thread_pool);
+	bio_slab_cleanup(&bio_ctx.async_job_slab);
+	bio_slab_cleanup(&bio_ctx.async_batch_slab);
+
+	// The thread may outlive the loop
+	if (bio_ctx.saved_loop_cpus != NULL) {
+		bio_platform_set_thread_affinity(bio_ctx.saved_loop_cpus, bio_ctx.num_saved_loop_cpus);
+		bio_free(bio_ctx.saved_loop_cpus);
+		bio_ctx.saved_loop_cpus = NULL;
+		bio_ctx.num_saved_loop_cpus = 0;
+	}
 }
 
-static void
-bio_thread_drain_responses(bio_worker_thread_t* worker) {
-	bio_worker_msg_t* msg;
-	while ((msg = bio_spscq_consume(&worker->response_queue, false)) != NULL) {
-		if (msg->type == BIO_WORKER_MSG_RUN) {
-			bio_raise_signal(msg->run.signal);
+void
+bio_thread_update(void) {
+	for (int i = 0; i < BIO_NUM_ASYNC_POOLS; ++i) {
+		bio_thread_pool_t* pool = bio_ctx.thread_pools[i];
+		bio_thread_resize_pool(pool);
+
+		bio_async_job_t* job = bio_take_completed_jobs(pool);
+		while (job != NULL) {
+			// A caller-owned job may be gone once its signal is raised
+			bio_async_job_t* next = job->next;
+			bool pooled = job->pooled;
+			bio_async_batch_t* batch = job->batch;
+			if (batch != NULL) {
+				bio_raise_signal(batch->signal);
+				bio_slab_free(&bio_ctx.async_batch_slab, batch);
+			} else {
+				bio_raise_signal(job->signal);
+			}
+			if (pooled) { bio_slab_free(&bio_ctx.async_job_slab, job); }
 			--bio_ctx.num_running_async_jobs;
-			--worker->load;
+			job = next;
 		}
+	}
+}
 
-		bio_free(msg);
+// A batch counts as a single running job since it completes once
+static void
+bio_submit_async_jobs(bio_async_job_t* jobs, int num_jobs) {
+	bio_async_pool_t pool_class = jobs[0].pool;
+	if ((unsigned int)pool_class >= BIO_NUM_ASYNC_POOLS) { pool_class = BIO_ASYNC_COMPUTE; }
+	bio_thread_pool_t* pool = bio_ctx.thread_pools[pool_class];
+
+	// Skip the slots without a thread, a retiring thread may still be picked
+	// but its jobs will be stolen
+	int num_slots = atomic_load_explicit(&pool->num_slots, memory_order_relaxed);
+	bio_worker_thread_t* worker;
+	do {
+		worker = &pool->workers[pool->next_worker];
+		if (++pool->next_worker >= num_slots) { pool->next_worker = 0; }
+	} while (atomic_load_explicit(&worker->state, memory_order_relaxed) != BIO_WORKER_RUNNING);
+
+	bio_job_deque_push(&worker->jobs, jobs, num_jobs);
+	++bio_ctx.num_running_async_jobs;
+
+	// Pairs with the sleeper count in bio_async_worker
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&pool->num_sleepers, memory_order_relaxed) > 0) {
+		atomic_fetch_add(&pool->wake_epoch, 1);
+		bio_platform_futex_wake(&pool->wake_epoch, num_jobs);
+	}
+
+	// Check later whether the jobs are still waiting for a thread.
+	// The sleepers may not be enough or already taken by earlier jobs.
+	if (
+		pool->saturated_since_us < 0
+		&& atomic_load_explicit(&pool->num_live_workers, memory_order_relaxed) < pool->max_workers
+	) {
+		pool->saturated_since_us = bio_platform_current_time_ns() / 1000;
 	}
 }
 
-void
-bio_thread_update(void) {
-	int num_threads = bio_ctx.options.thread_pool.num_threads;
-	bio_worker_thread_t* workers = bio_ctx.thread_pool;
-	for (int i = 0; i < num_threads; ++i) {
-		bio_thread_drain_responses(&workers[i]);
+bio_time_t
+bio_thread_time_until_resize_us(void) {
+	bio_time_t timeout_us = -1;
+	bio_time_t current_time_us = -1;
+	for (int i = 0; i < BIO_NUM_ASYNC_POOLS; ++i) {
+		bio_thread_pool_t* pool = bio_ctx.thread_pools[i];
+		if (pool->saturated_since_us < 0) { continue; }
+
+		if (current_time_us < 0) { current_time_us = bio_platform_current_time_ns() / 1000; }
+		bio_time_t elapsed_us = current_time_us - pool->saturated_since_us;
+		bio_time_t pool_timeout_us = elapsed_us < pool->spawn_delay_us
+			? pool->spawn_delay_us - elapsed_us
+			: 0;
+		if (timeout_us < 0 || pool_timeout_us < timeout_us) { timeout_us = pool_timeout_us; }
 	}
+
+	return timeout_us;
 }
 
 void
-bio_run_async(bio_entrypoint_t task, void* userdata, bio_signal_t signal) {
-	bio_worker_msg_t* msg = bio_malloc(sizeof(bio_worker_msg_t));
-	*msg = (bio_worker_msg_t){
-		.type = BIO_WORKER_MSG_RUN,
-		.need_notification = true,
-		.run = {
-			.fn = task,
-			.userdata = userdata,
-			.signal = signal,
-		},
+bio_run_async_ex(
+	bio_entrypoint_t task,
+	void* userdata,
+	bio_signal_t signal,
+	bio_async_pool_t pool
+) {
+	bio_async_job_t* job = bio_slab_alloc(&bio_ctx.async_job_slab);
+	*job = (bio_async_job_t){
+		.fn = task,
+		.userdata = userdata,
+		.signal = signal,
+		.pool = pool,
+		.pooled = true,
 	};
+	bio_submit_async_jobs(job, 1);
+}
 
-	int num_threads = bio_ctx.options.thread_pool.num_threads;
-	bio_worker_thread_t* workers = bio_ctx.thread_pool;
-	bool message_sent = false;
-	do {
-		// Try to send to the least busy worker
-		int chosen_worker_index = -1;
-		unsigned int min_load = UINT_MAX;
-		for (int i = 0; i < num_threads; ++i) {
-			bio_worker_thread_t* worker = &workers[i];
-
-			// Drain before submit to prevent queue from filling up
-			bio_thread_drain_responses(worker);
-
-			unsigned int load = worker->load;
-			if (load < min_load) {
-				min_load = load;
-				chosen_worker_index = i;
-			}
-		}
+void
+bio_run_async(bio_entrypoint_t task, void* userdata, bio_signal_t signal) {
+	bio_run_async_ex(task, userdata, signal, BIO_ASYNC_COMPUTE);
+}
 
-		bio_worker_thread_t* worker = &workers[chosen_worker_index];
-		if (bio_spscq_produce(&worker->request_queue, msg, false)) {
-			message_sent = true;
-			++bio_ctx.num_running_async_jobs;
-			++worker->load;
-			break;
-		}
+void
+bio_run_async_job(bio_async_job_t* job) {
+	job->next = NULL;
+	job->batch = NULL;
+	job->pooled = false;
+	bio_submit_async_jobs(job, 1);
+}
+
+void
+bio_run_async_batch(bio_async_job_t* jobs, int num_jobs, bio_signal_t signal) {
+	if (num_jobs <= 0) {
+		bio_raise_signal(signal);
+		return;
+	}
+
+	bio_async_batch_t* batch = bio_slab_alloc(&bio_ctx.async_batch_slab);
+	atomic_store_explicit(&batch->num_pending, num_jobs, memory_order_relaxed);
+	batch->signal = signal;
+
+	for (int i = 0; i < num_jobs; ++i) {
+		jobs[i].next = NULL;
+		jobs[i].batch = batch;
+		jobs[i].pooled = false;
+	}
+	bio_submit_async_jobs(jobs, num_jobs);
+}
+
+static void
+bio_parallel_for_chunk(void* userdata) {
+	bio_parallel_for_chunk_t* chunk = userdata;
+	chunk->fn(chunk->begin, chunk->end, chunk->userdata);
+}
+
+void
+bio_parallel_for(
+	size_t begin,
+	size_t end,
+	size_t grain,
+	bio_range_fn_t fn,
+	void* userdata
+) {
+	if (begin >= end) { return; }
+
+	size_t size = end - begin;
+	if (grain == 0) {
+		// One chunk per worker
+		size_t num_workers = (size_t)atomic_load(&bio_ctx.thread_pools[BIO_ASYNC_COMPUTE]->num_live_workers);
+		grain = (size + num_workers - 1) / num_workers;
+	}
+	// The number of jobs in a batch is an int
+	size_t min_grain = size / INT_MAX + 1;
+	if (grain < min_grain) { grain = min_grain; }
+	size_t num_chunks = (size + grain - 1) / grain;
+
+	bio_async_job_t* jobs = bio_malloc(
+		(sizeof(bio_async_job_t) + sizeof(bio_parallel_for_chunk_t)) * num_chunks
+	);
+	bio_parallel_for_chunk_t* chunks = (bio_parallel_for_chunk_t*)(jobs + num_chunks);
+	for (size_t i = 0; i < num_chunks; ++i) {
+		size_t chunk_begin = begin + i * grain;
+		size_t chunk_end = size - i * grain > grain ? chunk_begin + grain : end;
+		chunks[i] = (bio_parallel_for_chunk_t){
+			.fn = fn,
+			.userdata = userdata,
+			.begin = chunk_begin,
+			.end = chunk_end,
+		};
+		jobs[i] = (bio_async_job_t){
+			.fn = bio_parallel_for_chunk,
+			.userdata = &chunks[i],
+		};
+	}
+
+	bio_signal_t signal = bio_make_signal();
+	bio_run_async_batch(jobs, (int)num_chunks, signal);
+	bio_wait_for_one_signal(signal);
 
-		// Let other threads run
-		if (!message_sent) { bio_yield(); }
-	} while (!message_sent);
+	bio_free(jobs);
 }
 
 int32_t
@@ -1,178 +1,341 @@
 #include "internal.h"
 #include <bio/timer.h>
 
-#define BIO_INITIAL_TIMER_CAPACITY 4
+#define BIO_TIMER_WHEEL_MASK (BIO_TIMER_WHEEL_NUM_SLOTS - 1)
 
 static const bio_tag_t BIO_TIMER_HANDLE = BIO_TAG_INIT("bio.handle.timer");
 
 typedef struct {
-	bio_timer_type_t type;
-	bio_time_t timeout_ms;
+	bio_timer_link_t link;
+	bio_time_t due_time_us;
+	uint8_t level;
+	uint8_t slot;
+
+	// Set for timers created with bio_create_timer.
+	// Otherwise, this is a delayed signal.
 	bio_entrypoint_t fn;
-	void* userdata;
+	union {
+		bio_signal_t signal;
+		struct {
+			void* userdata;
+			bio_time_t timeout_us;
+			bio_time_t slack_us;
+			bio_handle_t handle;
+			bio_timer_type_t type;
+		} timer;
+	};
+} bio_timer_entry_t;
+
+static inline int
+bio_timer_find_first_set(uint64_t bits) {
+#ifdef __GNUC__
+	return __builtin_ctzll(bits);
+#else
+	int index = 0;
+	while ((bits & 1) == 0) {
+		bits >>= 1;
+		++index;
+	}
+	return index;
+#endif
+}
+
+static inline int
+bio_timer_find_last_set(uint64_t bits) {
+#ifdef __GNUC__
+	return 63 - __builtin_clzll(bits);
+#else
+	int index = 0;
+	while ((bits >>= 1) != 0) {
+		++index;
+	}
+	return index;
+#endif
+}
+
+// Pick a time between the due time and the end of the slack window which is
+// aligned to the coarsest power of two possible.
+// Timers with overlapping windows tend to be aligned to the same tick so they
+// are fired in a single wake up.
+static bio_time_t
+bio_timer_apply_slack(bio_time_t due_time, bio_time_t slack) {
+	if (slack <= 0) { return due_time; }
+
+	bio_time_t limit = due_time + slack;
+	int bit = bio_timer_find_last_set((uint64_t)(due_time ^ limit));
+	return limit & ~(((bio_time_t)1 << bit) - 1);
+}
+
+static void
+bio_timer_wheel_insert(bio_timer_wheel_t* wheel, bio_timer_entry_t* entry) {
+	bio_time_t tick = entry->due_time_us;
+	bio_time_t delta = tick - wheel->next_tick;
+	if (delta < 0) {
+		// Already due, fire on the next tick
+		tick = wheel->next_tick;
+		delta = 0;
+	}
+
+	bio_time_t range = (bio_time_t)1 << (BIO_TIMER_WHEEL_BITS * BIO_TIMER_WHEEL_NUM_LEVELS);
+	if (delta >= range) {
+		// Park at the far end of the top level.
+		// The real due time is used when it is cascaded.
+		tick = wheel->next_tick + range - 1;
+		delta = range - 1;
+	}
+
+	int level = 0;
+	while (delta >= ((bio_time_t)1 << (BIO_TIMER_WHEEL_BITS * (level + 1)))) {
+		++level;
+	}
+	int slot = (int)((tick >> (BIO_TIMER_WHEEL_BITS * level)) & BIO_TIMER_WHEEL_MASK);
 
-	bio_signal_t wake_signal;
-	bio_time_t due_time_ms;
-	bool cancelled;
-	bio_handle_t handle;
-} bio_timer_impl_t;
+	entry->level = (uint8_t)level;
+	entry->slot = (uint8_t)slot;
+	BIO_LIST_APPEND(&wheel->slots[level][slot], &entry->link);
+	wheel->occupied[level] |= (uint64_t)1 << slot;
+	++wheel->num_entries;
+}
+
+static void
+bio_timer_wheel_remove(bio_timer_wheel_t* wheel, bio_timer_entry_t* entry) {
+	// The entry is being fired
+	if (entry->link.next == NULL) { return; }
+
+	BIO_LIST_REMOVE(&entry->link);
+	if (BIO_LIST_IS_EMPTY(&wheel->slots[entry->level][entry->slot])) {
+		wheel->occupied[entry->level] &= ~((uint64_t)1 << entry->slot);
+	}
+	--wheel->num_entries;
+}
+
+// Move all entries of a slot to a separate list so that they can be
+// reinserted or fired without revisiting the slot
+static void
+bio_timer_wheel_take_slot(
+	bio_timer_wheel_t* wheel,
+	int level,
+	int slot,
+	bio_timer_link_t* list
+) {
+	bio_timer_link_t* head = &wheel->slots[level][slot];
+	if (BIO_LIST_IS_EMPTY(head)) {
+		BIO_LIST_INIT(list);
+		return;
+	}
+
+	list->next = head->next;
+	list->prev = head->prev;
+	list->next->prev = list;
+	list->prev->next = list;
+	BIO_LIST_INIT(head);
+	wheel->occupied[level] &= ~((uint64_t)1 << slot);
+}
+
+static bio_timer_entry_t*
+bio_timer_wheel_pop(bio_timer_wheel_t* wheel, bio_timer_link_t* list) {
+	bio_timer_link_t* link = list->next;
+	BIO_LIST_REMOVE(link);
+	--wheel->num_entries;
+	return BIO_CONTAINER_OF(link, bio_timer_entry_t, link);
+}
+
+// The first tick at which a slot has to be cascaded or fired
+static bio_time_t
+bio_timer_wheel_next_tick(const bio_timer_wheel_t* wheel) {
+	bio_time_t next_tick = INT64_MAX;
+	for (int level = 0; level < BIO_TIMER_WHEEL_NUM_LEVELS; ++level) {
+		uint64_t occupied = wheel->occupied[level];
+		if (occupied == 0) { continue; }
+
+		// A level is only processed when all levels below it wrap around
+		int shift = BIO_TIMER_WHEEL_BITS * level;
+		bio_time_t index = (wheel->next_tick + ((bio_time_t)1 << shift) - 1) >> shift;
+		int rotation = (int)(index & BIO_TIMER_WHEEL_MASK);
+		uint64_t rotated = rotation == 0
+			? occupied
+			: (occupied >> rotation) | (occupied << (BIO_TIMER_WHEEL_NUM_SLOTS - rotation));
+		bio_time_t tick = (index + bio_timer_find_first_set(rotated)) << shift;
+		if (tick < next_tick) { next_tick = tick; }
+	}
+
+	return next_tick;
+}
 
 void
 bio_timer_init(void) {
-	bio_ctx.timer_entries = bio_malloc(BIO_INITIAL_TIMER_CAPACITY * sizeof(bio_timer_entry_t));
-	bio_ctx.num_timers = 0;
-	bio_ctx.timer_capacity = BIO_INITIAL_TIMER_CAPACITY;
-	bio_ctx.current_time_ms = bio_platform_current_time_ms();
+	bio_timer_wheel_t* wheel = &bio_ctx.timer_wheel;
+	for (int level = 0; level < BIO_TIMER_WHEEL_NUM_LEVELS; ++level) {
+		for (int slot = 0; slot < BIO_TIMER_WHEEL_NUM_SLOTS; ++slot) {
+			BIO_LIST_INIT(&wheel->slots[level][slot]);
+		}
+		wheel->occupied[level] = 0;
+	}
+	wheel->num_entries = 0;
+	wheel->is_expiring = false;
+	bio_slab_init(&bio_ctx.timer_slab, sizeof(bio_timer_entry_t));
+	bio_ctx.num_active_timers = 0;
+	bio_ctx.current_time_us = bio_platform_current_time_ns() / 1000;
+	wheel->next_tick = bio_ctx.current_time_us;
 }
 
 void
 bio_timer_cleanup(void) {
-	bio_free(bio_ctx.timer_entries);
+	// Pending entries are released along with the slab
+	bio_slab_cleanup(&bio_ctx.timer_slab);
 }
 
-static inline int32_t
-bio_heap_parent(int32_t index) {
-    return (index - 1) / 2;
+void
+bio_raise_signal_after(bio_signal_t signal, bio_time_t time_ms) {
+	bio_raise_signal_after_us(signal, time_ms * 1000);
 }
 
-static void
-bio_heap_swap(bio_timer_entry_t* entries, int32_t index1, int32_t index2) {
-	bio_timer_entry_t temp = entries[index1];
-	entries[index1] = entries[index2];
-	entries[index2] = temp;
+void
+bio_raise_signal_after_us(bio_signal_t signal, bio_time_t time_us) {
+	bio_raise_signal_after_ex(signal, time_us, 0);
 }
 
 void
-bio_raise_signal_after(bio_signal_t signal, bio_time_t time_ms) {
-	if (BIO_LIKELY(time_ms > 0)) {
-		if (bio_ctx.num_timers == bio_ctx.timer_capacity) {
-			int32_t new_capacity = bio_ctx.timer_capacity * 2;
-			bio_ctx.timer_entries = bio_realloc(
-				bio_ctx.timer_entries,
-				new_capacity * sizeof(bio_timer_entry_t)
-			);
-			bio_ctx.timer_capacity = new_capacity;
-		}
-
-		// Heap insert the new timer
-		bio_time_t current_time = bio_ctx.current_time_ms;
-		int32_t current = bio_ctx.num_timers;
-		bio_ctx.timer_entries[current].due_time_ms = current_time + time_ms;
-		bio_ctx.timer_entries[current].signal = signal;
-		++bio_ctx.num_timers;
-
-		while (
-			current > 0
-			&& bio_ctx.timer_entries[bio_heap_parent(current)].due_time_ms > bio_ctx.timer_entries[current].due_time_ms
-		) {
-			int32_t parent = bio_heap_parent(current);
-			bio_heap_swap(bio_ctx.timer_entries, parent, current);
-			current = parent;
-		}
+bio_raise_signal_after_ex(bio_signal_t signal, bio_time_t time_us, bio_time_t slack_us) {
+	if (BIO_LIKELY(time_us > 0)) {
+		bio_timer_entry_t* entry = bio_slab_alloc(&bio_ctx.timer_slab);
+		*entry = (bio_timer_entry_t){
+			.due_time_us = bio_timer_apply_slack(bio_ctx.current_time_us + time_us, slack_us),
+			.signal = signal,
+		};
+		bio_timer_wheel_insert(&bio_ctx.timer_wheel, entry);
 	} else {
 		bio_raise_signal(signal);
 	}
 }
 
-void
-bio_timer_update(void) {
-	bio_time_t current_time = bio_ctx.current_time_ms = bio_platform_current_time_ms();
-
-	bio_timer_entry_t* entries = bio_ctx.timer_entries;
-	while (
-		bio_ctx.num_timers > 0
-		&& bio_ctx.timer_entries[0].due_time_ms <= current_time
-	) {
-		bio_timer_entry_t* entry = &entries[0];
+static void
+bio_timer_fire(bio_timer_entry_t* entry, bio_time_t current_time) {
+	if (entry->fn == NULL) {
 		bio_raise_signal(entry->signal);
+		bio_slab_free(&bio_ctx.timer_slab, entry);
+	} else if (entry->timer.type == BIO_TIMER_INTERVAL) {
+		// Rearm first so that the callback can reset or cancel the timer
+		entry->due_time_us = bio_timer_apply_slack(
+			current_time + entry->timer.timeout_us,
+			entry->timer.slack_us
+		);
+		bio_timer_wheel_insert(&bio_ctx.timer_wheel, entry);
+		entry->fn(entry->timer.userdata);
+	} else {
+		bio_entrypoint_t fn = entry->fn;
+		void* userdata = entry->timer.userdata;
+		bio_close_handle(entry->timer.handle, &BIO_TIMER_HANDLE);
+		bio_slab_free(&bio_ctx.timer_slab, entry);
+		--bio_ctx.num_active_timers;
+		fn(userdata);
+	}
+}
 
-		// Delete the timer
-		int32_t num_entries = --bio_ctx.num_timers;
-		*entry = entries[num_entries];
-		int32_t index = 0;
-		while (true) {
-			int32_t left = 2 * index + 1;
-			int32_t right = 2 * index + 2;
-			int32_t smallest = index;
-
-			if (left < num_entries && entries[left].due_time_ms < entries[smallest].due_time_ms) {
-				smallest = left;
-			}
-			if (right < num_entries && entries[right].due_time_ms < entries[smallest].due_time_ms) {
-				smallest = right;
-			}
+static void
+bio_timer_expire(bio_time_t current_time) {
+	bio_timer_wheel_t* wheel = &bio_ctx.timer_wheel;
+	if (wheel->is_expiring) { return; }
+	wheel->is_expiring = true;
+
+	// Jump straight to the ticks where something happens
+	bio_time_t tick;
+	while ((tick = bio_timer_wheel_next_tick(wheel)) <= current_time) {
+		wheel->next_tick = tick;
 
-			if (smallest == index) {
+		// Bring the upper levels down as the levels below them wrap around
+		for (int level = 1; level < BIO_TIMER_WHEEL_NUM_LEVELS; ++level) {
+			if (((tick >> (BIO_TIMER_WHEEL_BITS * (level - 1))) & BIO_TIMER_WHEEL_MASK) != 0) {
 				break;
 			}
 
-			bio_heap_swap(entries, index, smallest);
+			bio_timer_link_t cascaded;
+			int slot = (int)((tick >> (BIO_TIMER_WHEEL_BITS * level)) & BIO_TIMER_WHEEL_MASK);
+			bio_timer_wheel_take_slot(wheel, level, slot, &cascaded);
+			while (!BIO_LIST_IS_EMPTY(&cascaded)) {
+				bio_timer_wheel_insert(wheel, bio_timer_wheel_pop(wheel, &cascaded));
+			}
+		}
+
+		// Timers created by the callbacks go to the following ticks
+		wheel->next_tick = tick + 1;
 
-			index = smallest;
+		bio_timer_link_t expired;
+		bio_timer_wheel_take_slot(wheel, 0, (int)(tick & BIO_TIMER_WHEEL_MASK), &expired);
+		while (!BIO_LIST_IS_EMPTY(&expired)) {
+			bio_timer_fire(bio_timer_wheel_pop(wheel, &expired), current_time);
 		}
 	}
+
+	if (wheel->next_tick <= current_time) {
+		wheel->next_tick = current_time + 1;
+	}
+	wheel->is_expiring = false;
+}
+
+void
+bio_timer_update(void) {
+	bio_timer_expire(bio_ctx.current_time_us = bio_platform_current_time_ns() / 1000);
+}
+
+void
+bio_timer_poll(void) {
+	// New timers are still relative to the start of the current iteration so
+	// that timers created in the same iteration keep their relative order
+	bio_timer_expire(bio_platform_current_time_ns() / 1000);
 }
 
 bio_time_t
-bio_time_until_next_timer(void) {
-	if (bio_ctx.num_timers > 0) {
-		bio_time_t current_time = bio_platform_current_time_ms();
-		bio_time_t due_time = bio_ctx.timer_entries[0].due_time_ms;
-
-		if (due_time < current_time) {
-			return 0;
-		} else {
-			return due_time - current_time;
-		}
+bio_time_until_next_timer_us(void) {
+	bio_time_t next_tick = bio_timer_wheel_next_tick(&bio_ctx.timer_wheel);
+	if (next_tick == INT64_MAX) { return -1; }
+
+	// This can be a cascade instead of an actual timer which only results in
+	// an early wake up.
+	// The timers were just updated so the cached time is fresh enough.
+	bio_time_t current_time = bio_ctx.current_time_us;
+	if (next_tick < current_time) {
+		return 0;
 	} else {
-		return -1;
+		return next_tick - current_time;
 	}
 }
 
-static void
-bio_timer_entry(void* userdata) {
-	bio_timer_impl_t* impl = userdata;
-	while (true) {
-		impl->wake_signal = bio_make_signal();
-		bio_raise_signal_after(
-			impl->wake_signal,
-			impl->due_time_ms - bio_current_time_ms()
-		);
-		bio_wait_for_one_signal(impl->wake_signal);
-
-		bio_time_t current_time_ms = bio_current_time_ms();
-		if (impl->cancelled) {
-			break;
-		} else if (current_time_ms >= impl->due_time_ms) {
-			impl->fn(impl->userdata);
-			if (impl->type == BIO_TIMER_ONESHOT) {
-				break;
-			} else {
-				impl->due_time_ms = current_time_ms + impl->timeout_ms;
-			}
-		}
-	}
+bio_timer_t
+bio_create_timer(
+	bio_timer_type_t type, bio_time_t timeout_ms,
+	bio_entrypoint_t fn, void* userdata
+) {
+	return bio_create_timer_us(type, timeout_ms * 1000, fn, userdata);
+}
 
-	bio_close_handle(impl->handle, &BIO_TIMER_HANDLE);
-	bio_free(impl);
+bio_timer_t
+bio_create_timer_us(
+	bio_timer_type_t type, bio_time_t timeout_us,
+	bio_entrypoint_t fn, void* userdata
+) {
+	return bio_create_timer_ex(type, timeout_us, 0, fn, userdata);
 }
 
 bio_timer_t
-bio_create_timer(
-	bio_timer_type_t type, bio_time_t timeout_ms,
+bio_create_timer_ex(
+	bio_timer_type_t type, bio_time_t timeout_us, bio_time_t slack_us,
 	bio_entrypoint_t fn, void* userdata
 ) {
-	bio_timer_impl_t* impl = bio_malloc(sizeof(bio_timer_impl_t));
-	*impl = (bio_timer_impl_t){
-		.type = type,
-		.timeout_ms = timeout_ms,
+	bio_timer_entry_t* entry = bio_slab_alloc(&bio_ctx.timer_slab);
+	*entry = (bio_timer_entry_t){
+		.due_time_us = bio_timer_apply_slack(bio_ctx.current_time_us + timeout_us, slack_us),
 		.fn = fn,
-		.userdata = userdata,
-
-		.due_time_ms = bio_current_time_ms() + timeout_ms,
+		.timer = {
+			.userdata = userdata,
+			.timeout_us = timeout_us,
+			.slack_us = slack_us,
+			.type = type,
+		},
 	};
-	bio_handle_t handle = impl->handle = bio_make_handle(impl, &BIO_TIMER_HANDLE);
-	bio_spawn(bio_timer_entry, impl);
+	bio_handle_t handle = entry->timer.handle = bio_make_handle(entry, &BIO_TIMER_HANDLE);
+	bio_timer_wheel_insert(&bio_ctx.timer_wheel, entry);
+	++bio_ctx.num_active_timers;
 
 	return (bio_timer_t){ .handle = handle };
 }
@@ -184,19 +347,29 @@ bio_is_timer_pending(bio_timer_t timer) {
 
 void
 bio_reset_timer(bio_timer_t timer, bio_time_t timeout_ms) {
-	bio_timer_impl_t* impl = bio_resolve_handle(timer.handle, &BIO_TIMER_HANDLE);
-	if (BIO_LIKELY(impl != NULL)) {
-		impl->timeout_ms = timeout_ms;
-		impl->due_time_ms = bio_current_time_ms() + timeout_ms;
+	bio_reset_timer_us(timer, timeout_ms * 1000);
+}
+
+void
+bio_reset_timer_us(bio_timer_t timer, bio_time_t timeout_us) {
+	bio_timer_entry_t* entry = bio_resolve_handle(timer.handle, &BIO_TIMER_HANDLE);
+	if (BIO_LIKELY(entry != NULL)) {
+		bio_timer_wheel_remove(&bio_ctx.timer_wheel, entry);
+		entry->timer.timeout_us = timeout_us;
+		entry->due_time_us = bio_timer_apply_slack(
+			bio_ctx.current_time_us + timeout_us,
+			entry->timer.slack_us
+		);
+		bio_timer_wheel_insert(&bio_ctx.timer_wheel, entry);
 	}
 }
 
 void
 bio_cancel_timer(bio_timer_t timer) {
-	bio_timer_impl_t* impl = bio_resolve_handle(timer.handle, &BIO_TIMER_HANDLE);
-	if (BIO_LIKELY(impl != NULL)) {
-		impl->cancelled = true;
-		bio_raise_signal(impl->wake_signal);
-		bio_close_handle(impl->handle, &BIO_TIMER_HANDLE);
+	bio_timer_entry_t* entry = bio_close_handle(timer.handle, &BIO_TIMER_HANDLE);
+	if (BIO_LIKELY(entry != NULL)) {
+		bio_timer_wheel_remove(&bio_ctx.timer_wheel, entry);
+		bio_slab_free(&bio_ctx.timer_slab, entry);
+		--bio_ctx.num_active_timers;
 	}
 }
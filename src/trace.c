@@ -0,0 +1,331 @@
+#include "internal.h"
+#include <bio/trace.h>
+#include <minicoro.h>
+#include <inttypes.h>
+#include <string.h>
+
+#define BIO_TRACE_NAME_LEN 32
+// Formatted events are written in chunks of this size
+#define BIO_TRACE_BUFFER_SIZE 65536
+// Upper bound on the size of one formatted event, names included
+#define BIO_TRACE_MAX_EVENT_SIZE 512
+
+typedef struct {
+	int64_t timestamp_ns;
+	bio_trace_event_type_t type;
+	bio_handle_t coro;
+	// The coroutine raising the signal
+	bio_handle_t source;
+	// Identifies an I/O request
+	uintptr_t id;
+	// Opcode on submission, result on completion
+	int32_t value;
+	// Copied since the name may not outlive the coroutine
+	char name[BIO_TRACE_NAME_LEN];
+} bio_trace_event_t;
+
+struct bio_trace_s {
+	bio_trace_options_t options;
+	int64_t start_time_ns;
+
+	// Single producer (the loop) and single consumer (the formatter running
+	// in the thread pool).
+	// The indices are free running and only masked on access.
+	bio_trace_event_t* events;
+	uint32_t capacity;
+	atomic_uint head;
+	atomic_uint tail;
+	uint32_t num_dropped_events;
+	uint32_t num_reported_dropped_events;
+
+	// Flushing
+	bio_coro_t flusher;
+	bio_signal_t stop_signal;
+	bool stop_requested;
+	uint32_t flush_end;
+	char* buffer;
+	size_t buffer_len;
+};
+
+static const char BIO_TRACE_HEADER[] =
+	"[\n"
+	"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"bio\"}},\n"
+	"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"loop\"}}";
+
+static const char BIO_TRACE_FOOTER[] = "\n]\n";
+
+static bool
+bio_trace_push(bio_trace_t* trace, const bio_trace_event_t* event) {
+	uint32_t tail = atomic_load_explicit(&trace->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&trace->head, memory_order_acquire);
+	if (tail - head >= trace->capacity) {
+		++trace->num_dropped_events;
+		return false;
+	}
+
+	trace->events[tail & (trace->capacity - 1)] = *event;
+	atomic_store_explicit(&trace->tail, tail + 1, memory_order_release);
+	return true;
+}
+
+static void
+bio_trace_copy_name(char* dst, const char* src) {
+	size_t len = strlen(src);
+	if (len >= BIO_TRACE_NAME_LEN) { len = BIO_TRACE_NAME_LEN - 1; }
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
+
+void
+bio_trace_coro_event(bio_trace_event_type_t type, bio_coro_impl_t* coro) {
+	bio_trace_t* trace = bio_ctx.trace;
+	// The flusher would otherwise record events about its own flushing
+	if (bio_handle_compare(coro->handle, trace->flusher.handle) == 0) { return; }
+
+	bio_trace_event_t event = {
+		.timestamp_ns = bio_platform_current_time_ns(),
+		.type = type,
+		.coro = coro->handle,
+	};
+	if (type == BIO_TRACE_RESUME) {
+		bio_trace_copy_name(event.name, coro->name != NULL ? coro->name : "coro");
+	} else if (type == BIO_TRACE_RAISE) {
+		mco_coro* running = mco_running();
+		if (running != NULL) {
+			event.source = ((bio_coro_impl_t*)running->user_data)->handle;
+		}
+	}
+
+	bio_trace_push(trace, &event);
+}
+
+bool
+bio_trace_io_event(bio_trace_event_type_t type, const void* request, int32_t value) {
+	bio_trace_t* trace = bio_ctx.trace;
+	bio_trace_event_t event = {
+		.timestamp_ns = bio_platform_current_time_ns(),
+		.type = type,
+		.id = (uintptr_t)request,
+		.value = value,
+	};
+
+	mco_coro* running = mco_running();
+	if (type == BIO_TRACE_IO_SUBMIT && running != NULL) {
+		bio_coro_impl_t* coro = running->user_data;
+		if (bio_handle_compare(coro->handle, trace->flusher.handle) == 0) { return false; }
+		event.coro = coro->handle;
+	}
+
+	return bio_trace_push(trace, &event);
+}
+
+static void
+bio_trace_escape_name(char* dst, const char* src) {
+	for (; *src != '\0'; ++src) {
+		char ch = *src;
+		if (ch == '"' || ch == '\\') {
+			*dst++ = '\\';
+			*dst++ = ch;
+		} else if ((unsigned char)ch >= 0x20) {
+			*dst++ = ch;
+		}
+	}
+	*dst = '\0';
+}
+
+static int
+bio_trace_format_event(
+	const bio_trace_t* trace,
+	const bio_trace_event_t* event,
+	char* buf,
+	size_t size
+) {
+	double ts = (double)(event->timestamp_ns - trace->start_time_ns) / 1000.0;
+	int tid = event->coro.index;
+
+	switch (event->type) {
+		case BIO_TRACE_RESUME: {
+			char name[BIO_TRACE_NAME_LEN * 2];
+			bio_trace_escape_name(name, event->name);
+			return snprintf(
+				buf, size,
+				",\n{\"name\":\"%s\",\"cat\":\"coro\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"handle\":\"%d:%d\"}}",
+				name, ts, tid,
+				event->coro.index, event->coro.gen
+			);
+		}
+		case BIO_TRACE_YIELD:
+		case BIO_TRACE_WAIT:
+		case BIO_TRACE_EXIT: {
+			const char* reason = event->type == BIO_TRACE_YIELD
+				? "yield"
+				: (event->type == BIO_TRACE_WAIT ? "wait" : "exit");
+			return snprintf(
+				buf, size,
+				",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"reason\":\"%s\"}}",
+				ts, tid, reason
+			);
+		}
+		case BIO_TRACE_RAISE:
+			return snprintf(
+				buf, size,
+				",\n{\"name\":\"wake\",\"cat\":\"signal\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"by\":\"%d:%d\"}}",
+				ts, tid,
+				event->source.index, event->source.gen
+			);
+		case BIO_TRACE_IO_SUBMIT:
+			return snprintf(
+				buf, size,
+				",\n{\"name\":\"io\",\"cat\":\"io\",\"ph\":\"b\",\"id\":\"0x%" PRIxPTR "\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"op\":%" PRId32 "}}",
+				event->id, ts, tid, event->value
+			);
+		case BIO_TRACE_IO_COMPLETE:
+			return snprintf(
+				buf, size,
+				",\n{\"name\":\"io\",\"cat\":\"io\",\"ph\":\"e\",\"id\":\"0x%" PRIxPTR "\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"res\":%" PRId32 "}}",
+				event->id, ts, tid, event->value
+			);
+	}
+
+	return 0;
+}
+
+// Runs in the thread pool, it must not touch the loop context
+static void
+bio_trace_format(void* userdata) {
+	bio_trace_t* trace = userdata;
+
+	size_t len = 0;
+	uint32_t head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+	uint32_t end = trace->flush_end;
+	while (head != end && BIO_TRACE_BUFFER_SIZE - len >= BIO_TRACE_MAX_EVENT_SIZE) {
+		const bio_trace_event_t* event = &trace->events[head & (trace->capacity - 1)];
+		int num_chars = bio_trace_format_event(
+			trace, event,
+			trace->buffer + len, BIO_TRACE_BUFFER_SIZE - len
+		);
+		if (num_chars > 0) { len += (size_t)num_chars; }
+		++head;
+	}
+
+	// Release the slots to the producer
+	atomic_store_explicit(&trace->head, head, memory_order_release);
+	trace->buffer_len = len;
+}
+
+static void
+bio_trace_flush(bio_trace_t* trace) {
+	// Only take what was recorded so far so a busy loop cannot keep the
+	// flusher going
+	trace->flush_end = atomic_load_explicit(&trace->tail, memory_order_relaxed);
+	while (atomic_load_explicit(&trace->head, memory_order_relaxed) != trace->flush_end) {
+		bio_run_async_and_wait(bio_trace_format, trace);
+		bio_fwrite_exactly(trace->options.file, trace->buffer, trace->buffer_len, NULL);
+	}
+
+	// Make gaps in the timeline visible
+	if (trace->num_dropped_events != trace->num_reported_dropped_events) {
+		trace->num_reported_dropped_events = trace->num_dropped_events;
+
+		double ts = (double)(bio_platform_current_time_ns() - trace->start_time_ns) / 1000.0;
+		int len = snprintf(
+			trace->buffer, BIO_TRACE_BUFFER_SIZE,
+			",\n{\"name\":\"dropped events\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"count\":%" PRIu32 "}}",
+			ts, trace->num_dropped_events
+		);
+		bio_fwrite_exactly(trace->options.file, trace->buffer, (size_t)len, NULL);
+	}
+}
+
+static void
+bio_trace_flusher_entry(void* userdata) {
+	bio_trace_t* trace = userdata;
+	bio_set_coro_name("bio.trace");
+	trace->stop_signal = bio_make_signal();
+
+	bio_fwrite_exactly(trace->options.file, BIO_TRACE_HEADER, sizeof(BIO_TRACE_HEADER) - 1, NULL);
+
+	while (true) {
+		bio_trace_flush(trace);
+		if (trace->stop_requested) { break; }
+
+		bio_signal_t flush_signal = bio_make_signal();
+		bio_raise_signal_after(flush_signal, trace->options.flush_interval_ms);
+		bio_signal_t signals[] = { trace->stop_signal, flush_signal };
+		bio_wait_for_signals(signals, sizeof(signals) / sizeof(signals[0]), false);
+	}
+
+	bio_fwrite_exactly(trace->options.file, BIO_TRACE_FOOTER, sizeof(BIO_TRACE_FOOTER) - 1, NULL);
+
+	bio_free(trace->buffer);
+	bio_free(trace->events);
+	bio_free(trace);
+}
+
+bool
+bio_start_trace(const bio_trace_options_t* options) {
+	if (bio_ctx.trace != NULL) { return false; }
+
+	bio_trace_t* trace = bio_malloc(sizeof(bio_trace_t));
+	*trace = (bio_trace_t){
+		.options = *options,
+		.start_time_ns = bio_platform_current_time_ns(),
+	};
+	if (trace->options.ring_size <= 0) {
+		trace->options.ring_size = BIO_DEFAULT_TRACE_RING_SIZE;
+	}
+	if (trace->options.flush_interval_ms <= 0) {
+		trace->options.flush_interval_ms = BIO_DEFAULT_TRACE_FLUSH_INTERVAL_MS;
+	}
+
+	trace->capacity = bio_next_pow2((uint32_t)trace->options.ring_size);
+	trace->events = bio_malloc(sizeof(bio_trace_event_t) * trace->capacity);
+	trace->buffer = bio_malloc(BIO_TRACE_BUFFER_SIZE);
+	atomic_store(&trace->head, 0);
+	atomic_store(&trace->tail, 0);
+
+	trace->flusher = bio_spawn_ex(
+		bio_trace_flusher_entry, trace,
+		&(bio_coro_options_t){ .daemon = true }
+	);
+	bio_ctx.trace = trace;
+
+	return true;
+}
+
+static bio_coro_t
+bio_request_trace_stop(void) {
+	bio_trace_t* trace = bio_ctx.trace;
+	if (trace == NULL) { return (bio_coro_t){ .handle = BIO_INVALID_HANDLE }; }
+
+	// Stop recording right away, the flusher owns the trace from now on
+	bio_ctx.trace = NULL;
+	trace->stop_requested = true;
+	bio_raise_signal(trace->stop_signal);
+
+	return trace->flusher;
+}
+
+void
+bio_stop_trace(void) {
+	bio_coro_t flusher = bio_request_trace_stop();
+	if (mco_running() != NULL) {
+		// This returns immediately if the flusher has already exited
+		bio_join(flusher);
+	}
+}
+
+bool
+bio_is_tracing(void) {
+	return bio_ctx.trace != NULL;
+}
+
+void
+bio_trace_cleanup(void) {
+	// The flusher finishes in the loop run by bio_terminate
+	bio_request_trace_stop();
+}
@@ -0,0 +1,67 @@
+#include "internal.h"
+
+static const bio_tag_t BIO_WAIT_GROUP_HANDLE = BIO_TAG_INIT("bio.handle.wait_group");
+
+// Lives on the stack of the waiting coroutine
+typedef struct {
+	bio_wait_group_link_t link;
+	bio_waiter_t waiter;
+} bio_wait_group_waiter_t;
+
+static void
+bio_wake_wait_group(bio_wait_group_impl_t* impl) {
+	while (!BIO_LIST_IS_EMPTY(&impl->waiters)) {
+		bio_wait_group_waiter_t* waiter = BIO_CONTAINER_OF(
+			impl->waiters.next, bio_wait_group_waiter_t, link
+		);
+		BIO_LIST_REMOVE(&waiter->link);
+		bio_raise_waiter(&waiter->waiter);
+	}
+}
+
+bio_wait_group_t
+bio_make_wait_group(void) {
+	bio_wait_group_impl_t* impl = bio_slab_alloc(&bio_ctx.wait_group_slab);
+	*impl = (bio_wait_group_impl_t){ .counter = 0 };
+	BIO_LIST_INIT(&impl->waiters);
+	impl->handle = bio_make_handle(impl, &BIO_WAIT_GROUP_HANDLE);
+
+	return (bio_wait_group_t){ .handle = impl->handle };
+}
+
+void
+bio_close_wait_group(bio_wait_group_t group) {
+	bio_wait_group_impl_t* impl = bio_close_handle(group.handle, &BIO_WAIT_GROUP_HANDLE);
+	if (BIO_LIKELY(impl != NULL)) {
+		bio_wake_wait_group(impl);
+		bio_slab_free(&bio_ctx.wait_group_slab, impl);
+	}
+}
+
+void
+bio_wait_group_add(bio_wait_group_t group, int delta) {
+	bio_wait_group_impl_t* impl = bio_resolve_handle(group.handle, &BIO_WAIT_GROUP_HANDLE);
+	if (BIO_LIKELY(impl != NULL)) {
+		impl->counter += delta;
+		if (impl->counter <= 0) {
+			impl->counter = 0;
+			bio_wake_wait_group(impl);
+		}
+	}
+}
+
+void
+bio_wait_group_wait(bio_wait_group_t group) {
+	bio_wait_group_impl_t* impl = bio_resolve_handle(group.handle, &BIO_WAIT_GROUP_HANDLE);
+	if (BIO_LIKELY(impl != NULL && impl->counter > 0)) {
+		bio_wait_group_waiter_t waiter;
+		bio_prepare_waiter(&waiter.waiter);
+		if (BIO_LIKELY(waiter.waiter.owner != NULL)) {
+			BIO_LIST_APPEND(&impl->waiters, &waiter.link);
+			// The group may be closed during the wait so impl must not be
+			// touched afterwards.
+			// The waiter is always unlinked before it is raised.
+			bio_wait_for_waiter(&waiter.waiter);
+		}
+	}
+}
@@ -127,6 +127,8 @@ bio_fs_stat_file(void* userdata) {
 
 void
 bio_fs_init(void) {
+	bio_slab_init(&bio_ctx.file_slab, sizeof(bio_file_impl_t));
+
 	bio_fdopen(&BIO_STDIN, (uintptr_t)GetStdHandle(STD_INPUT_HANDLE), NULL);
 	bio_fdopen(&BIO_STDOUT, (uintptr_t)GetStdHandle(STD_OUTPUT_HANDLE), NULL);
 	bio_fdopen(&BIO_STDERR, (uintptr_t)GetStdHandle(STD_ERROR_HANDLE), NULL);
@@ -134,9 +136,11 @@ bio_fs_init(void) {
 
 void
 bio_fs_cleanup(void) {
-	bio_free(bio_close_handle(BIO_STDIN.handle, &BIO_FILE_HANDLE));
-	bio_free(bio_close_handle(BIO_STDOUT.handle, &BIO_FILE_HANDLE));
-	bio_free(bio_close_handle(BIO_STDERR.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDIN.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDOUT.handle, &BIO_FILE_HANDLE));
+	bio_slab_free(&bio_ctx.file_slab, bio_close_handle(BIO_STDERR.handle, &BIO_FILE_HANDLE));
+
+	bio_slab_cleanup(&bio_ctx.file_slab);
 }
 
 bool
@@ -200,7 +204,7 @@ bio_fopen(
 		.creation_disposition = creation_disposition,
 		.filename = filename,
 	};
-	bio_run_async_and_wait(bio_fs_open_file, &args);
+	bio_run_async_and_wait_ex(bio_fs_open_file, &args, BIO_ASYNC_BLOCKING);
     if (args.error != ERROR_SUCCESS) {
         bio_set_error(error, args.error);
         return false;
@@ -228,7 +232,7 @@ bio_fdopen(bio_file_t* file_ptr, uintptr_t fd, bio_error_t* error) {
 		completion_mode = BIO_COMPLETION_MODE_SKIP_ON_SUCCESS;
 	}
 
-	bio_file_impl_t* impl = bio_malloc(sizeof(bio_file_impl_t));
+	bio_file_impl_t* impl = bio_slab_alloc(&bio_ctx.file_slab);
 	*impl = (bio_file_impl_t){
 		.handle = (HANDLE)fd,
 		.completion_mode = completion_mode,
@@ -268,7 +272,7 @@ bio_fwrite(
 			.handle = impl->handle,
 			.overlapped = &req.overlapped,
 		};
-		bio_run_async_and_wait(bio_fs_write_file, &args);
+		bio_run_async_and_wait_ex(bio_fs_write_file, &args, BIO_ASYNC_BLOCKING);
 		if (args.error == ERROR_SUCCESS) {
 			bio_maybe_wait_after_success(&req, impl->completion_mode);
 			impl->offset += args.bytes_transferred;
@@ -312,7 +316,7 @@ bio_fread(
 			.handle = impl->handle,
 			.overlapped = &req.overlapped,
 		};
-		bio_run_async_and_wait(bio_fs_read_file, &args);
+		bio_run_async_and_wait_ex(bio_fs_read_file, &args, BIO_ASYNC_BLOCKING);
 		if (args.error == ERROR_SUCCESS) {
 			bio_maybe_wait_after_success(&req, impl->completion_mode);
 			impl->offset += args.bytes_transferred;
@@ -383,7 +387,7 @@ bio_fflush(bio_file_t file, bio_error_t* error) {
 	bio_file_impl_t* impl = bio_resolve_handle(file.handle, &BIO_FILE_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
 		bio_fs_simple_args_t args = { .handle = impl->handle };
-		bio_run_async_and_wait(bio_fs_flush_file, &args);
+		bio_run_async_and_wait_ex(bio_fs_flush_file, &args, BIO_ASYNC_BLOCKING);
 		if (args.error != ERROR_SUCCESS) {
 			bio_set_error(error, args.error);
 			return false;
@@ -401,8 +405,8 @@ bio_fclose(bio_file_t file, bio_error_t* error) {
 	bio_file_impl_t* impl = bio_close_handle(file.handle, &BIO_FILE_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
 		bio_fs_simple_args_t args = { .handle = impl->handle };
-		bio_run_async_and_wait(bio_fs_close_file, &args);
-		bio_free(impl);
+		bio_run_async_and_wait_ex(bio_fs_close_file, &args, BIO_ASYNC_BLOCKING);
+		bio_slab_free(&bio_ctx.file_slab, impl);
 		if (args.error != ERROR_SUCCESS) {
 			bio_set_error(error, args.error);
 			return false;
@@ -420,10 +424,27 @@ bio_fstat(bio_file_t file, bio_stat_t* stat, bio_error_t* error) {
 	bio_file_impl_t* impl = bio_resolve_handle(file.handle, &BIO_FILE_HANDLE);
 	if (BIO_LIKELY(impl != NULL)) {
 		bio_fs_stat_args_t args = { .handle = impl->handle, .stat = stat };
-		bio_run_async_and_wait(bio_fs_stat_file, &args);
+		bio_run_async_and_wait_ex(bio_fs_stat_file, &args, BIO_ASYNC_BLOCKING);
 		return args.error == ERROR_SUCCESS;
 	} else {
 		bio_set_error(error, ERROR_INVALID_HANDLE);
 		return 0;
 	}
 }
+
+size_t
+bio_fread_ex(
+	bio_file_t file,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	// Per-operation timeouts are only implemented with io_uring linked timeouts
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return 0;
+	}
+
+	return bio_fread(file, buf, size, error);
+}
@@ -82,17 +82,19 @@ bio_translate_address(
 
 void
 bio_net_init(void) {
+	bio_slab_init(&bio_ctx.socket_slab, sizeof(bio_socket_impl_t));
 	WSAStartup(MAKEWORD(2, 2), &bio_ctx.platform.wsadata);
 }
 
 void
 bio_net_cleanup(void) {
 	WSACleanup();
+	bio_slab_cleanup(&bio_ctx.socket_slab);
 }
 
 static bio_socket_t
 bio_net_make_socket(const bio_socket_impl_t* proto) {
-	bio_socket_impl_t* instance = bio_malloc(sizeof(bio_socket_impl_t));
+	bio_socket_impl_t* instance = bio_slab_alloc(&bio_ctx.socket_slab);
 	*instance = *proto;
 	return (bio_socket_t){
 		.handle = bio_make_handle(instance, &BIO_SOCKET_HANDLE),
@@ -245,7 +247,7 @@ bio_net_close(bio_socket_t socket, bio_error_t* error) {
 		} else {
 			success = bio_net_pipe_close(&impl->pipe, error);
 		}
-		bio_free(impl);
+		bio_slab_free(&bio_ctx.socket_slab, impl);
 		return true;
 	} else {
 		bio_set_error(error, ERROR_INVALID_HANDLE);
@@ -296,3 +298,69 @@ bio_net_recv(
 		return 0;
 	}
 }
+
+// Per-operation timeouts are only implemented with io_uring linked timeouts
+
+bool
+bio_net_accept_ex(
+	bio_socket_t socket,
+	bio_socket_t* client,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return false;
+	}
+
+	return bio_net_accept(socket, client, error);
+}
+
+bool
+bio_net_connect_ex(
+	bio_socket_type_t socket_type,
+	const bio_addr_t* addr,
+	bio_port_t port,
+	bio_socket_t* sock,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return false;
+	}
+
+	return bio_net_connect(socket_type, addr, port, sock, error);
+}
+
+size_t
+bio_net_send_ex(
+	bio_socket_t socket,
+	const void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return 0;
+	}
+
+	return bio_net_send(socket, buf, size, error);
+}
+
+size_t
+bio_net_recv_ex(
+	bio_socket_t socket,
+	void* buf,
+	size_t size,
+	bio_time_t timeout_ms,
+	bio_error_t* error
+) {
+	if (timeout_ms > 0) {
+		bio_set_core_error(error, BIO_ERROR_NOT_SUPPORTED);
+		return 0;
+	}
+
+	return bio_net_recv(socket, buf, size, error);
+}
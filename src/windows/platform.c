@@ -5,6 +5,10 @@ const bio_tag_t BIO_PLATFORM_ERROR = BIO_TAG_INIT("bio.error.windows");
 static const char BIO_WINDOWS_NOTIFY_KEY = 0;
 static const char BIO_WINDOWS_EXIT_SIGNAL_KEY = 0;
 
+// The console handler runs in its own thread so it cannot use the thread-local
+// context of the loop that installed it
+static HANDLE bio_exit_signal_iocp = NULL;
+
 static ULONG
 bio_platform_process_events(DWORD timeout_ms, DWORD batch_size) {
 	ULONG num_entries = 0;
@@ -31,7 +35,7 @@ bio_platform_process_events(DWORD timeout_ms, DWORD batch_size) {
 
 static BOOL WINAPI
 bio_on_exit_signal(DWORD type) {
-	PostQueuedCompletionStatus(bio_ctx.platform.iocp, 0, (uintptr_t)&BIO_WINDOWS_EXIT_SIGNAL_KEY, NULL);
+	PostQueuedCompletionStatus(bio_exit_signal_iocp, 0, (uintptr_t)&BIO_WINDOWS_EXIT_SIGNAL_KEY, NULL);
 	return TRUE;
 }
 
@@ -70,11 +74,26 @@ bio_platform_current_time_ms(void) {
 	return q * numer + r * numer / denom;
 }
 
+int64_t
+bio_platform_current_time_ns(void) {
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	LONGLONG diff = now.QuadPart - bio_ctx.platform.start_time.QuadPart;
+	int64_t denom = bio_ctx.platform.perf_counter_freq.QuadPart;
+	int64_t numer = 1000000000;
+	int64_t q = diff / denom;
+	int64_t r = diff % denom;
+	return q * numer + r * numer / denom;
+}
+
 void
-bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
+bio_platform_update(bio_time_t wait_timeout_us, bool notifiable) {
 	unsigned int batch_size = bio_ctx.options.windows.iocp.batch_size;
 	if (batch_size == 0) { batch_size = BIO_WINDOWS_DEFAULT_BATCH_SIZE; }
 
+	// IOCP only waits in milliseconds, round up so timers are never early
+	bio_time_t wait_timeout_ms = wait_timeout_us < 0 ? -1 : (wait_timeout_us + 999) / 1000;
+
 	if (wait_timeout_ms >= INFINITE) { wait_timeout_ms = INFINITE - 1;  }
 	if (wait_timeout_ms < 0) { wait_timeout_ms = INFINITE;  }
 
@@ -86,8 +105,56 @@ bio_platform_update(bio_time_t wait_timeout_ms, bool notifiable) {
 }
 
 void
-bio_platform_notify(void) {
-	PostQueuedCompletionStatus(bio_ctx.platform.iocp, 0, (uintptr_t)&BIO_WINDOWS_NOTIFY_KEY, NULL);
+bio_platform_notify(bio_platform_t* platform) {
+	PostQueuedCompletionStatus(platform->iocp, 0, (uintptr_t)&BIO_WINDOWS_NOTIFY_KEY, NULL);
+}
+
+bool
+bio_platform_futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms) {
+	BOOL woken = WaitOnAddress(
+		(volatile VOID*)addr, &expected, sizeof(expected),
+		timeout_ms >= 0 ? (DWORD)timeout_ms : INFINITE
+	);
+	return woken || GetLastError() != ERROR_TIMEOUT;
+}
+
+void
+bio_platform_futex_wake(atomic_uint* addr, int count) {
+	if (count == 1) {
+		WakeByAddressSingle((PVOID)addr);
+	} else {
+		WakeByAddressAll((PVOID)addr);
+	}
+}
+
+// Only the processor group of the calling thread is supported
+bool
+bio_platform_set_thread_affinity(const int* cpus, int num_cpus) {
+	DWORD_PTR mask = 0;
+	for (int i = 0; i < num_cpus; ++i) {
+		if (0 <= cpus[i] && cpus[i] < (int)(sizeof(mask) * 8)) {
+			mask |= (DWORD_PTR)1 << cpus[i];
+		}
+	}
+	return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
+int
+bio_platform_get_thread_affinity(int* cpus, int max_cpus) {
+	// There is no getter for a thread so the previous mask is restored
+	DWORD_PTR process_mask, system_mask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+		return 0;
+	}
+	DWORD_PTR mask = SetThreadAffinityMask(GetCurrentThread(), process_mask);
+	if (mask == 0) { return 0; }
+	SetThreadAffinityMask(GetCurrentThread(), mask);
+
+	int num_cpus = 0;
+	for (int cpu = 0; cpu < (int)(sizeof(mask) * 8) && num_cpus < max_cpus; ++cpu) {
+		if ((mask >> cpu) & 1) { cpus[num_cpus++] = cpu; }
+	}
+	return num_cpus;
 }
 
 bio_io_req_t
@@ -167,6 +234,7 @@ void
 void
 bio_platform_block_exit_signal(void) {
 	if (!bio_ctx.platform.signal_blocked) {
+		bio_exit_signal_iocp = bio_ctx.platform.iocp;
 		SetConsoleCtrlHandler(bio_on_exit_signal, TRUE);
 		bio_ctx.platform.signal_blocked = true;
 	}
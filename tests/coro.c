@@ -276,3 +276,208 @@ BIO_TEST(coro, daemon) {
 		.daemon = true,
 	});
 }
+
+static void
+count_and_yield(void* userdata) {
+	int* counter = userdata;
+	bio_yield();
+	++(*counter);
+}
+
+BIO_TEST(coro, reuse) {
+	int counter = 0;
+	bio_coro_t first = bio_spawn(count_and_yield, &counter);
+	bio_join(first);
+	BTEST_EXPECT(counter == 1);
+
+	// Finished coroutines are recycled but their handles must stay invalid
+	for (int i = 0; i < 8; ++i) {
+		bio_coro_t coro = bio_spawn_ex(count_and_yield, &counter, &(bio_coro_options_t){
+			.stack_size = (i % 2) == 0 ? 0 : 128 * 1024,
+		});
+		BTEST_EXPECT(bio_coro_state(first) == BIO_CORO_DEAD);
+		bio_join(coro);
+		BTEST_EXPECT(bio_coro_state(coro) == BIO_CORO_DEAD);
+	}
+	BTEST_EXPECT(counter == 9);
+}
+
+typedef struct {
+	int order[3];
+	int num_runs;
+} priority_ctx_t;
+
+typedef struct {
+	priority_ctx_t* ctx;
+	int id;
+} priority_arg_t;
+
+static void
+record_run(void* userdata) {
+	priority_arg_t* arg = userdata;
+	arg->ctx->order[arg->ctx->num_runs++] = arg->id;
+}
+
+BIO_TEST(coro, priority) {
+	priority_ctx_t ctx = { 0 };
+	priority_arg_t low = { .ctx = &ctx, .id = BIO_CORO_PRIORITY_LOW };
+	priority_arg_t normal = { .ctx = &ctx, .id = BIO_CORO_PRIORITY_NORMAL };
+	priority_arg_t high = { .ctx = &ctx, .id = BIO_CORO_PRIORITY_HIGH };
+
+	bio_coro_t coros[] = {
+		bio_spawn_ex(record_run, &low, &(bio_coro_options_t){ .priority = BIO_CORO_PRIORITY_LOW }),
+		bio_spawn_ex(record_run, &normal, NULL),
+		bio_spawn_ex(record_run, &high, &(bio_coro_options_t){ .priority = BIO_CORO_PRIORITY_HIGH }),
+	};
+	for (int i = 0; i < 3; ++i) {
+		bio_join(coros[i]);
+	}
+
+	BTEST_EXPECT(ctx.num_runs == 3);
+	BTEST_EXPECT(ctx.order[0] == BIO_CORO_PRIORITY_HIGH);
+	BTEST_EXPECT(ctx.order[1] == BIO_CORO_PRIORITY_NORMAL);
+	BTEST_EXPECT(ctx.order[2] == BIO_CORO_PRIORITY_LOW);
+}
+
+#define NUM_CLS 20
+
+static int num_cls_cleanups = 0;
+
+static void
+init_cls(void* data) {
+	*(int*)data = -1;
+}
+
+static void
+cleanup_cls(void* data) {
+	(void)data;
+	++num_cls_cleanups;
+}
+
+static bio_cls_t cls_specs[NUM_CLS];
+
+static void
+use_cls(void* userdata) {
+	// Spill over from the inline slots into the table
+	for (int i = 0; i < NUM_CLS; ++i) {
+		int* value = bio_get_cls(&cls_specs[i]);
+		BTEST_EXPECT(*value == -1);
+		*value = i;
+	}
+
+	bio_yield();
+
+	for (int i = 0; i < NUM_CLS; ++i) {
+		int* value = bio_get_cls(&cls_specs[i]);
+		BTEST_EXPECT(*value == i);
+	}
+}
+
+BIO_TEST(coro, cls) {
+	for (int i = 0; i < NUM_CLS; ++i) {
+		// Small data comes from a slab, large data is allocated individually
+		size_t size = i % 2 == 0 ? sizeof(int) : 4096;
+		cls_specs[i] = (bio_cls_t){ .size = size, .init = init_cls, .cleanup = cleanup_cls };
+	}
+	num_cls_cleanups = 0;
+	bio_join(bio_spawn(use_cls, NULL));
+	BTEST_EXPECT(num_cls_cleanups == NUM_CLS);
+
+	// A recycled coroutine starts with no CLS
+	bio_join(bio_spawn(use_cls, NULL));
+	BTEST_EXPECT(num_cls_cleanups == NUM_CLS * 2);
+}
+
+static void
+init_nested_cls(void* data) {
+	// Grow the table while this CLS is still being initialized
+	for (int i = 0; i < NUM_CLS; ++i) {
+		int* value = bio_get_cls(&cls_specs[i]);
+		BTEST_EXPECT(*value == -1);
+	}
+	*(int*)data = 42;
+}
+
+static const bio_cls_t nested_cls_spec = {
+	.size = sizeof(int),
+	.init = init_nested_cls,
+	.cleanup = cleanup_cls,
+};
+
+static void
+use_nested_cls(void* userdata) {
+	// Fill the inline slots so the nested CLS goes into the table
+	for (int i = 0; i < 4; ++i) {
+		bio_get_cls(&cls_specs[i]);
+	}
+
+	int* value = bio_get_cls(&nested_cls_spec);
+	BTEST_EXPECT(*value == 42);
+	BTEST_EXPECT(bio_get_cls(&nested_cls_spec) == value);
+}
+
+BIO_TEST(coro, nested_cls) {
+	for (int i = 0; i < NUM_CLS; ++i) {
+		cls_specs[i] = (bio_cls_t){ .size = sizeof(int), .init = init_cls, .cleanup = cleanup_cls };
+	}
+	num_cls_cleanups = 0;
+	bio_join(bio_spawn(use_nested_cls, NULL));
+	BTEST_EXPECT(num_cls_cleanups == NUM_CLS + 1);
+}
+
+#define NUM_WAIT_GROUP_TASKS 1000
+
+typedef struct {
+	bio_wait_group_t group;
+	int num_done;
+} wait_group_ctx_t;
+
+static void
+wait_group_task(void* userdata) {
+	wait_group_ctx_t* ctx = userdata;
+	bio_yield();
+	++ctx->num_done;
+	bio_wait_group_done(ctx->group);
+}
+
+static void
+wait_group_waiter(void* userdata) {
+	wait_group_ctx_t* ctx = userdata;
+	bio_join(ctx->group);
+	BTEST_EXPECT(ctx->num_done == NUM_WAIT_GROUP_TASKS);
+}
+
+BIO_TEST(coro, wait_group) {
+	wait_group_ctx_t ctx = { .group = bio_make_wait_group() };
+
+	// Waiting on an empty group returns immediately
+	bio_join(ctx.group);
+
+	for (int i = 0; i < NUM_WAIT_GROUP_TASKS; ++i) {
+		bio_wait_group_add(ctx.group, 1);
+		bio_spawn(wait_group_task, &ctx);
+	}
+	bio_coro_t other_waiter = bio_spawn(wait_group_waiter, &ctx);
+
+	bio_wait_group_wait(ctx.group);
+	BTEST_EXPECT(ctx.num_done == NUM_WAIT_GROUP_TASKS);
+	bio_join(other_waiter);
+
+	bio_close_wait_group(ctx.group);
+	bio_wait_group_add(ctx.group, 1);
+	bio_join(ctx.group);  // Invalid group
+}
+
+static void
+close_wait_group(void* userdata) {
+	bio_close_wait_group(*(bio_wait_group_t*)userdata);
+}
+
+BIO_TEST(coro, close_wait_group) {
+	bio_wait_group_t group = bio_make_wait_group();
+	bio_wait_group_add(group, 1);
+	bio_spawn(close_wait_group, &group);
+
+	// Closing the group resumes its waiters
+	bio_join(group);
+}
@@ -70,3 +70,26 @@ TEST(handle, info) {
 	const bio_tag_t* file_tag = bio_handle_info(BIO_STDIN.handle);
 	CHECK(strcmp(file_tag->name, "bio.handle.file") == 0, "Invalid tag");
 }
+
+TEST(handle, resolve_many) {
+	bio_tag_t tag1 = BIO_TAG_INIT("tag1");
+	bio_tag_t tag2 = BIO_TAG_INIT("tag2");
+
+	int a, b, c;
+	bio_handle_t handles[] = {
+		bio_make_handle(&a, &tag1),
+		bio_make_handle(&b, &tag2),  // Wrong tag
+		bio_make_handle(&c, &tag1),
+		BIO_INVALID_HANDLE,
+		{ .index = 1000 },  // Out of range
+	};
+	bio_close_handle(handles[2], &tag1);
+
+	void* objs[sizeof(handles) / sizeof(handles[0])];
+	bio_resolve_handles(handles, sizeof(handles) / sizeof(handles[0]), &tag1, objs);
+	CHECK(objs[0] == &a, "Invalid resolution");
+	CHECK(objs[1] == NULL, "Invalid resolution");
+	CHECK(objs[2] == NULL, "Invalid resolution");
+	CHECK(objs[3] == NULL, "Invalid resolution");
+	CHECK(objs[4] == NULL, "Invalid resolution");
+}
@@ -0,0 +1,183 @@
+#include "common.h"
+#include <threads.h>
+#include <stdatomic.h>
+
+static suite_t loop = {
+	.name = "loop",
+	.init_per_test = init_bio,
+	.cleanup_per_test = cleanup_bio,
+};
+
+typedef struct {
+	bio_loop_t main_loop;
+	bio_signal_t main_done;
+
+	_Atomic(void*) worker_loop;
+	bio_signal_t worker_stop;
+	thrd_t worker_thread;
+	atomic_bool ran_on_worker;
+} loop_ctx_t;
+
+static void
+worker_keeper(void* userdata) {
+	loop_ctx_t* ctx = userdata;
+	ctx->worker_stop = bio_make_signal();
+	atomic_store(&ctx->worker_loop, bio_current_loop().ctx);
+	bio_wait_for_one_signal(ctx->worker_stop);
+}
+
+static int
+worker_thread(void* userdata) {
+	bio_init(NULL);
+	bio_spawn(worker_keeper, userdata);
+	bio_loop();
+	bio_terminate();
+	return 0;
+}
+
+static void
+set_flag(void* userdata) {
+	*(bool*)userdata = true;
+}
+
+static void
+reply_on_main(void* userdata) {
+	loop_ctx_t* ctx = userdata;
+	bio_raise_signal(ctx->main_done);
+}
+
+static void
+run_on_worker(void* userdata) {
+	loop_ctx_t* ctx = userdata;
+	atomic_store(&ctx->ran_on_worker, thrd_equal(thrd_current(), ctx->worker_thread));
+	bio_raise_signal(ctx->worker_stop);
+	bio_spawn_on(ctx->main_loop, reply_on_main, ctx, NULL);
+}
+
+BIO_TEST(loop, spawn_on) {
+	loop_ctx_t ctx = {
+		.main_loop = bio_current_loop(),
+		.main_done = bio_make_signal(),
+	};
+	CHECK(thrd_create(&ctx.worker_thread, worker_thread, &ctx) == thrd_success, "Could not create thread");
+
+	void* worker_loop;
+	while ((worker_loop = atomic_load(&ctx.worker_loop)) == NULL) {
+		thrd_yield();
+	}
+
+	BTEST_EXPECT(bio_spawn_on((bio_loop_t){ .ctx = worker_loop }, run_on_worker, &ctx, NULL));
+	bio_wait_for_one_signal(ctx.main_done);
+	BTEST_EXPECT(atomic_load(&ctx.ran_on_worker));
+
+	thrd_join(ctx.worker_thread, NULL);
+
+	// The reference outlives the loop but requests are rejected
+	bool flag = false;
+	BTEST_EXPECT(!bio_spawn_on((bio_loop_t){ .ctx = worker_loop }, set_flag, &flag, NULL));
+	bio_release_loop((bio_loop_t){ .ctx = worker_loop });
+	bio_release_loop(ctx.main_loop);
+}
+
+BIO_TEST(loop, spawn_on_self) {
+	bool flag = false;
+	bio_loop_t self = bio_current_loop();
+	BTEST_EXPECT(bio_spawn_on(self, set_flag, &flag, NULL));
+	bio_release_loop(self);
+	bio_yield();
+	BTEST_EXPECT(flag);
+	BTEST_EXPECT(!bio_spawn_on((bio_loop_t){ 0 }, set_flag, &flag, NULL));
+}
+
+typedef struct {
+	_Atomic(void*) loop;
+	bio_signal_t stop;
+	thrd_t thread;
+} stealing_worker_t;
+
+typedef struct {
+	stealing_worker_t busy;
+	stealing_worker_t idle;
+	atomic_bool busy_started;
+	atomic_bool released;
+	atomic_bool ran_on_idle;
+} stealing_ctx_t;
+
+static void
+stealing_keeper(void* userdata) {
+	stealing_worker_t* worker = userdata;
+	worker->stop = bio_make_signal();
+	atomic_store(&worker->loop, bio_current_loop().ctx);
+	bio_wait_for_one_signal(worker->stop);
+}
+
+static int
+stealing_worker_thread(void* userdata) {
+	bio_init(&(bio_options_t){
+		.loop.spawn_stealing = true,
+	});
+	bio_spawn(stealing_keeper, userdata);
+	bio_loop();
+	bio_terminate();
+	return 0;
+}
+
+static void
+stop_worker(void* userdata) {
+	stealing_worker_t* worker = userdata;
+	bio_raise_signal(worker->stop);
+}
+
+static void
+release_busy_loop(void* userdata) {
+	stealing_ctx_t* ctx = userdata;
+	atomic_store(&ctx->ran_on_idle, thrd_equal(thrd_current(), ctx->idle.thread));
+	atomic_store(&ctx->released, true);
+}
+
+static void
+block_loop(void* userdata) {
+	stealing_ctx_t* ctx = userdata;
+	atomic_store(&ctx->busy_started, true);
+
+	// Hog the thread so only another loop can make progress
+	while (!atomic_load(&ctx->released)) {
+		thrd_yield();
+	}
+
+	bio_spawn_on((bio_loop_t){ .ctx = atomic_load(&ctx->idle.loop) }, stop_worker, &ctx->idle, NULL);
+	bio_raise_signal(ctx->busy.stop);
+}
+
+static void*
+wait_for_loop(stealing_worker_t* worker) {
+	void* loop;
+	while ((loop = atomic_load(&worker->loop)) == NULL) {
+		thrd_yield();
+	}
+	return loop;
+}
+
+TEST(loop, spawn_stealing) {
+	stealing_ctx_t ctx = { 0 };
+	CHECK(thrd_create(&ctx.busy.thread, stealing_worker_thread, &ctx.busy) == thrd_success, "Could not create thread");
+	CHECK(thrd_create(&ctx.idle.thread, stealing_worker_thread, &ctx.idle) == thrd_success, "Could not create thread");
+
+	bio_loop_t busy_loop = { .ctx = wait_for_loop(&ctx.busy) };
+	wait_for_loop(&ctx.idle);
+
+	BTEST_EXPECT(bio_spawn_on(busy_loop, block_loop, &ctx, NULL));
+	while (!atomic_load(&ctx.busy_started)) {
+		thrd_yield();
+	}
+
+	// The busy loop can only be released if the other loop steals this
+	BTEST_EXPECT(bio_spawn_on(busy_loop, release_busy_loop, &ctx, NULL));
+
+	thrd_join(ctx.busy.thread, NULL);
+	thrd_join(ctx.idle.thread, NULL);
+	BTEST_EXPECT(atomic_load(&ctx.ran_on_idle));
+
+	bio_release_loop(busy_loop);
+	bio_release_loop((bio_loop_t){ .ctx = atomic_load(&ctx.idle.loop) });
+}
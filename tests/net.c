@@ -314,3 +314,54 @@ BIO_TEST(net, tcp_echo) {
 
 	bio_net_close(server_socket, NULL);
 }
+
+#ifdef __linux__
+
+BIO_TEST(net, timeout) {
+	bio_socket_t server_socket;
+	bio_error_t error = { 0 };
+	bio_net_listen(
+		BIO_SOCKET_STREAM,
+		&BIO_ADDR_IPV4_LOOPBACK,
+		8089,
+		&server_socket,
+		&error
+	);
+	CHECK_NO_ERROR(error);
+
+	bio_socket_t server_side;
+	CHECK(!bio_net_accept_ex(server_socket, &server_side, 10, &error), "Accept did not time out");
+	CHECK(error.tag == &BIO_CORE_ERROR && error.code == BIO_ERROR_TIMED_OUT, "Invalid error");
+	error = (bio_error_t){ 0 };
+
+	bio_socket_t client_side;
+	bio_net_connect_ex(
+		BIO_SOCKET_STREAM,
+		&BIO_ADDR_IPV4_LOOPBACK,
+		8089,
+		&client_side,
+		1000,
+		&error
+	);
+	CHECK_NO_ERROR(error);
+	bio_net_accept_ex(server_socket, &server_side, 1000, &error);
+	CHECK_NO_ERROR(error);
+
+	char buf[4];
+	CHECK(bio_net_recv_ex(client_side, buf, sizeof(buf), 10, &error) == 0, "Recv did not time out");
+	CHECK(error.tag == &BIO_CORE_ERROR && error.code == BIO_ERROR_TIMED_OUT, "Invalid error");
+	error = (bio_error_t){ 0 };
+
+	// The connection is still usable after a timeout
+	bio_net_send_ex(server_side, "ping", 4, 1000, &error);
+	CHECK_NO_ERROR(error);
+	size_t bytes_received = bio_net_recv_ex(client_side, buf, sizeof(buf), 1000, &error);
+	CHECK_NO_ERROR(error);
+	CHECK(bytes_received == 4 && memcmp(buf, "ping", 4) == 0, "Invalid data");
+
+	bio_net_close(client_side, NULL);
+	bio_net_close(server_side, NULL);
+	bio_net_close(server_socket, NULL);
+}
+
+#endif
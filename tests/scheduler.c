@@ -0,0 +1,202 @@
+#include "common.h"
+#include <threads.h>
+
+#define RESUME_BUDGET 64
+
+static void
+init_scheduler(void) {
+	bio_init(&(bio_options_t){
+		.scheduler = {
+			.max_resumes_per_poll = RESUME_BUDGET,
+			.lifo_slot = true,
+			.collect_coro_stats = true,
+		},
+	});
+}
+
+static suite_t scheduler = {
+	.name = "scheduler",
+	.init_per_test = init_scheduler,
+	.cleanup_per_test = cleanup_bio,
+};
+
+#define NUM_BUSY_COROS (RESUME_BUDGET * 4)
+
+typedef struct {
+	bool slept;
+	int num_runs;
+	int waiter_position;
+} budget_ctx_t;
+
+static void
+wait_for_timer(void* userdata) {
+	budget_ctx_t* ctx = userdata;
+	bio_signal_t signal = bio_make_signal();
+	bio_raise_signal_after(signal, 1);
+	bio_wait_for_one_signal(signal);
+	ctx->waiter_position = ctx->num_runs++;
+}
+
+static void
+busy_coro(void* userdata) {
+	budget_ctx_t* ctx = userdata;
+	if (!ctx->slept) {
+		// Make sure the timer is due by the time the budget runs out
+		ctx->slept = true;
+		thrd_sleep(&(struct timespec){ .tv_nsec = 2000000 }, NULL);
+	}
+	bio_yield();
+	++ctx->num_runs;
+}
+
+BIO_TEST(scheduler, run_budget) {
+	budget_ctx_t ctx = { 0 };
+	bio_coro_t waiter = bio_spawn(wait_for_timer, &ctx);
+	bio_coro_t busy_coros[NUM_BUSY_COROS];
+	for (int i = 0; i < NUM_BUSY_COROS; ++i) {
+		busy_coros[i] = bio_spawn(busy_coro, &ctx);
+	}
+
+	bio_join(waiter);
+	for (int i = 0; i < NUM_BUSY_COROS; ++i) {
+		bio_join(busy_coros[i]);
+	}
+
+	// The timer was checked before all busy coroutines were resumed
+	BTEST_EXPECT(ctx.waiter_position < NUM_BUSY_COROS);
+}
+
+typedef struct {
+	int num_runs;
+	int waiter_position;
+	bio_signal_t signal;
+} lifo_ctx_t;
+
+static void
+lifo_waiter(void* userdata) {
+	lifo_ctx_t* ctx = userdata;
+	ctx->signal = bio_make_signal();
+	bio_wait_for_one_signal(ctx->signal);
+	ctx->waiter_position = ctx->num_runs++;
+}
+
+static void
+lifo_filler(void* userdata) {
+	lifo_ctx_t* ctx = userdata;
+	bio_yield();
+	++ctx->num_runs;
+}
+
+BIO_TEST(scheduler, lifo_slot) {
+	lifo_ctx_t ctx = { 0 };
+	bio_coro_t coros[] = {
+		bio_spawn(lifo_waiter, &ctx),
+		bio_spawn(lifo_filler, &ctx),
+		bio_spawn(lifo_filler, &ctx),
+	};
+	bio_yield();
+
+	// The waiter is woken up last but runs before the fillers
+	bio_raise_signal(ctx.signal);
+	for (int i = 0; i < 3; ++i) {
+		bio_join(coros[i]);
+	}
+	BTEST_EXPECT_EX(ctx.waiter_position == 0, "waiter_position = %d", ctx.waiter_position);
+}
+
+#define NUM_PING_PONG_ROUNDS 100
+
+typedef struct {
+	bio_signal_t signals[2];
+	int num_rounds;
+	int rounds_seen_by_bystander;
+} ping_pong_ctx_t;
+
+typedef struct {
+	ping_pong_ctx_t* ctx;
+	int id;
+} ping_pong_arg_t;
+
+static void
+ping_pong(void* userdata) {
+	ping_pong_arg_t* arg = userdata;
+	ping_pong_ctx_t* ctx = arg->ctx;
+	while (ctx->num_rounds < NUM_PING_PONG_ROUNDS) {
+		ctx->signals[arg->id] = bio_make_signal();
+		bio_raise_signal(ctx->signals[!arg->id]);
+		++ctx->num_rounds;
+		bio_wait_for_one_signal(ctx->signals[arg->id]);
+	}
+	bio_raise_signal(ctx->signals[!arg->id]);
+}
+
+static void
+bystander(void* userdata) {
+	ping_pong_ctx_t* ctx = userdata;
+	bio_yield();
+	ctx->rounds_seen_by_bystander = ctx->num_rounds;
+}
+
+BIO_TEST(scheduler, lifo_starvation) {
+	ping_pong_ctx_t ctx = { 0 };
+	bio_coro_t coros[] = {
+		bio_spawn(ping_pong, &(ping_pong_arg_t){ .ctx = &ctx, .id = 0 }),
+		bio_spawn(ping_pong, &(ping_pong_arg_t){ .ctx = &ctx, .id = 1 }),
+		bio_spawn(bystander, &ctx),
+	};
+	for (int i = 0; i < 3; ++i) {
+		bio_join(coros[i]);
+	}
+
+	// The ping pong chain was cut to let others run
+	BTEST_EXPECT(ctx.num_rounds >= NUM_PING_PONG_ROUNDS);
+	BTEST_EXPECT(ctx.rounds_seen_by_bystander < NUM_PING_PONG_ROUNDS);
+}
+
+typedef struct {
+	bio_signal_t started;
+	bio_signal_t resume;
+} stats_ctx_t;
+
+static void
+measured(void* userdata) {
+	stats_ctx_t* ctx = userdata;
+	bio_set_coro_name("measured");
+
+	bio_signal_t sleep_signal = bio_make_signal();
+	bio_raise_signal_after(sleep_signal, 10);
+	bio_wait_for_one_signal(sleep_signal);
+
+	// Burn some CPU time
+	int64_t start_time = bio_current_time_ms();
+	while (bio_current_time_ms() - start_time < 3) { }
+
+	bio_raise_signal(ctx->started);
+	ctx->resume = bio_make_signal();
+	bio_wait_for_one_signal(ctx->resume);
+}
+
+BIO_TEST(scheduler, coro_stats) {
+	stats_ctx_t ctx = { .started = bio_make_signal() };
+	bio_coro_t coro = bio_spawn(measured, &ctx);
+	bio_wait_for_one_signal(ctx.started);
+
+	bio_coro_stats_t stats;
+	BTEST_EXPECT(bio_get_coro_stats(coro, &stats));
+	BTEST_EXPECT(stats.num_resumes == 2);
+	BTEST_EXPECT(stats.run_time_ns >= 2000000);
+	BTEST_EXPECT(stats.wait_time_ns >= 5000000);
+
+	bio_coro_stats_t name_stats;
+	BTEST_EXPECT(bio_get_coro_stats_by_name("measured", &name_stats));
+	BTEST_EXPECT(name_stats.num_resumes == stats.num_resumes);
+
+	bio_raise_signal(ctx.resume);
+	bio_join(coro);
+	BTEST_EXPECT(!bio_get_coro_stats(coro, &stats));
+
+	// Stats of a name outlive its coroutines
+	BTEST_EXPECT(bio_get_coro_stats_by_name("measured", &name_stats));
+	BTEST_EXPECT(name_stats.num_resumes == 3);
+	BTEST_EXPECT(!bio_get_coro_stats_by_name("unknown", &name_stats));
+}
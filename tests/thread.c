@@ -1,5 +1,13 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
 #include "common.h"
 #include <bio/bio.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <string.h>
 
 static btest_suite_t thread = {
 	.name = "thread",
@@ -21,3 +29,316 @@ BIO_TEST(thread, run_async) {
 	bio_run_async_and_wait(async_task, &data);
 	BTEST_EXPECT(data == 42);
 }
+
+static atomic_bool slow_task_finished;
+
+static void
+slow_task(void* userdata) {
+	thrd_sleep(&(struct timespec){ .tv_nsec = 200 * 1000 * 1000 }, NULL);
+	atomic_store(&slow_task_finished, true);
+}
+
+static void
+quick_task(void* userdata) {
+	bool* finished_before_slow_task = userdata;
+	*finished_before_slow_task = !atomic_load(&slow_task_finished);
+}
+
+BIO_TEST(thread, steal) {
+	atomic_store(&slow_task_finished, false);
+
+	// Half of the quick tasks are queued behind the slow one
+	bio_signal_t slow_signal = bio_make_signal();
+	bio_run_async(slow_task, NULL, slow_signal);
+
+	enum { NUM_QUICK_TASKS = 20 };
+	bool finished_before_slow_task[NUM_QUICK_TASKS] = { 0 };
+	bio_signal_t quick_signals[NUM_QUICK_TASKS];
+	for (int i = 0; i < NUM_QUICK_TASKS; ++i) {
+		quick_signals[i] = bio_make_signal();
+		bio_run_async(quick_task, &finished_before_slow_task[i], quick_signals[i]);
+	}
+
+	bio_wait_for_signals(quick_signals, NUM_QUICK_TASKS, true);
+	for (int i = 0; i < NUM_QUICK_TASKS; ++i) {
+		BTEST_EXPECT(finished_before_slow_task[i]);
+	}
+
+	bio_wait_for_one_signal(slow_signal);
+}
+
+static void
+count_task(void* userdata) {
+	atomic_int* counter = userdata;
+	atomic_fetch_add(counter, 1);
+}
+
+BIO_TEST(thread, many_completions) {
+	atomic_int counter;
+	atomic_store(&counter, 0);
+
+	enum { NUM_TASKS = 100 };
+	bio_signal_t signals[NUM_TASKS];
+	for (int i = 0; i < NUM_TASKS; ++i) {
+		signals[i] = bio_make_signal();
+		bio_run_async(count_task, &counter, signals[i]);
+	}
+
+	bio_wait_for_signals(signals, NUM_TASKS, true);
+	BTEST_EXPECT(atomic_load(&counter) == NUM_TASKS);
+}
+
+BIO_TEST(thread, caller_owned_job) {
+	int data[4] = { 0 };
+	bio_async_job_t jobs[4];
+	bio_signal_t signals[4];
+	for (int i = 0; i < 4; ++i) {
+		jobs[i] = (bio_async_job_t){
+			.fn = async_task,
+			.userdata = &data[i],
+			.signal = bio_make_signal(),
+		};
+		signals[i] = jobs[i].signal;
+		bio_run_async_job(&jobs[i]);
+	}
+
+	bio_wait_for_signals(signals, 4, true);
+	for (int i = 0; i < 4; ++i) {
+		BTEST_EXPECT(data[i] == 42);
+	}
+}
+
+BIO_TEST(thread, batch) {
+	int data[8] = { 0 };
+	bio_async_job_t jobs[8];
+	for (int i = 0; i < 8; ++i) {
+		jobs[i] = (bio_async_job_t){
+			.fn = async_task,
+			.userdata = &data[i],
+		};
+	}
+
+	bio_signal_t signal = bio_make_signal();
+	bio_run_async_batch(jobs, 8, signal);
+	bio_wait_for_one_signal(signal);
+	for (int i = 0; i < 8; ++i) {
+		BTEST_EXPECT(data[i] == 42);
+	}
+
+	// An empty batch completes immediately
+	signal = bio_make_signal();
+	bio_run_async_batch(NULL, 0, signal);
+	bio_wait_for_one_signal(signal);
+}
+
+typedef struct {
+	atomic_int num_chunks;
+	int visits[1000];
+} parallel_for_ctx_t;
+
+static void
+parallel_for_task(size_t begin, size_t end, void* userdata) {
+	parallel_for_ctx_t* ctx = userdata;
+	atomic_fetch_add(&ctx->num_chunks, 1);
+	for (size_t i = begin; i < end; ++i) {
+		++ctx->visits[i];
+	}
+}
+
+BIO_TEST(thread, parallel_for) {
+	static parallel_for_ctx_t ctx;
+	atomic_store(&ctx.num_chunks, 0);
+
+	bio_parallel_for(10, 1000, 64, parallel_for_task, &ctx);
+	BTEST_EXPECT(atomic_load(&ctx.num_chunks) == 16);
+	for (int i = 0; i < 1000; ++i) {
+		BTEST_EXPECT(ctx.visits[i] == (i >= 10 ? 1 : 0));
+	}
+
+	// Split evenly
+	memset(ctx.visits, 0, sizeof(ctx.visits));
+	atomic_store(&ctx.num_chunks, 0);
+	bio_parallel_for(0, 1000, 0, parallel_for_task, &ctx);
+	BTEST_EXPECT(atomic_load(&ctx.num_chunks) == 2);
+	for (int i = 0; i < 1000; ++i) {
+		BTEST_EXPECT(ctx.visits[i] == 1);
+	}
+}
+
+static void
+init_elastic_pool(void) {
+	bio_init(&(bio_options_t){
+		.thread_pool = {
+			.num_threads = 1,
+			.max_threads = 3,
+			.spawn_delay_ms = 5,
+			.idle_timeout_ms = 50,
+		},
+	});
+}
+
+static btest_suite_t elastic_thread = {
+	.name = "elastic_thread",
+	.init_per_test = init_elastic_pool,
+	.cleanup_per_test = cleanup_bio,
+};
+
+typedef struct {
+	atomic_int num_started;
+	atomic_bool released;
+} blocking_ctx_t;
+
+static void
+blocking_task(void* userdata) {
+	blocking_ctx_t* ctx = userdata;
+	atomic_fetch_add(&ctx->num_started, 1);
+	while (!atomic_load(&ctx->released)) {
+		thrd_sleep(&(struct timespec){ .tv_nsec = 1000 * 1000 }, NULL);
+	}
+}
+
+static void
+run_blocking_tasks(void) {
+	blocking_ctx_t ctx;
+	atomic_store(&ctx.num_started, 0);
+	atomic_store(&ctx.released, false);
+
+	bio_async_job_t jobs[3];
+	bio_signal_t signals[3];
+	for (int i = 0; i < 3; ++i) {
+		jobs[i] = (bio_async_job_t){
+			.fn = blocking_task,
+			.userdata = &ctx,
+			.signal = bio_make_signal(),
+		};
+		signals[i] = jobs[i].signal;
+		bio_run_async_job(&jobs[i]);
+	}
+
+	// All tasks can only run together if the pool grows
+	for (int i = 0; i < 200 && atomic_load(&ctx.num_started) < 3; ++i) {
+		bio_signal_t timer = bio_make_signal();
+		bio_raise_signal_after(timer, 10);
+		bio_wait_for_one_signal(timer);
+	}
+	BTEST_EXPECT(atomic_load(&ctx.num_started) == 3);
+
+	atomic_store(&ctx.released, true);
+	bio_wait_for_signals(signals, 3, true);
+}
+
+BIO_TEST(elastic_thread, grow_and_shrink) {
+	run_blocking_tasks();
+
+	// Let the extra threads retire
+	bio_signal_t timer = bio_make_signal();
+	bio_raise_signal_after(timer, 200);
+	bio_wait_for_one_signal(timer);
+
+	// The pool grows again
+	run_blocking_tasks();
+}
+
+BIO_TEST(thread, blocking_pool) {
+	blocking_ctx_t ctx;
+	atomic_store(&ctx.num_started, 0);
+	atomic_store(&ctx.released, false);
+
+	// Occupy more threads than the compute pool has
+	enum { NUM_BLOCKING_TASKS = 4 };
+	bio_signal_t signals[NUM_BLOCKING_TASKS];
+	for (int i = 0; i < NUM_BLOCKING_TASKS; ++i) {
+		signals[i] = bio_make_signal();
+		bio_run_async_ex(blocking_task, &ctx, signals[i], BIO_ASYNC_BLOCKING);
+	}
+
+	// Compute jobs are not held up
+	int data = 0;
+	bio_run_async_and_wait(async_task, &data);
+	BTEST_EXPECT(data == 42);
+	BTEST_EXPECT(!atomic_load(&ctx.released));
+
+	atomic_store(&ctx.released, true);
+	bio_wait_for_signals(signals, NUM_BLOCKING_TASKS, true);
+	BTEST_EXPECT(atomic_load(&ctx.num_started) == NUM_BLOCKING_TASKS);
+}
+
+#ifdef __linux__
+
+// The first CPU this process may run on, which is not always CPU 0
+static int test_cpu[1];
+
+static void
+init_pinned_pool(void) {
+	cpu_set_t set;
+	sched_getaffinity(0, sizeof(set), &set);
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &set)) {
+			test_cpu[0] = cpu;
+			break;
+		}
+	}
+
+	bio_init(&(bio_options_t){
+		.thread_pool = {
+			.cpus = test_cpu,
+			.num_cpus = 1,
+		},
+		.loop = {
+			.cpus = test_cpu,
+			.num_cpus = 1,
+		},
+	});
+}
+
+static btest_suite_t pinned_thread = {
+	.name = "pinned_thread",
+	.init_per_test = init_pinned_pool,
+	.cleanup_per_test = cleanup_bio,
+};
+
+static bool
+is_pinned_to_test_cpu(void) {
+	cpu_set_t set;
+	sched_getaffinity(0, sizeof(set), &set);
+	return CPU_COUNT(&set) == 1 && CPU_ISSET(test_cpu[0], &set);
+}
+
+static void
+affinity_task(void* userdata) {
+	bool* pinned = userdata;
+	*pinned = is_pinned_to_test_cpu();
+}
+
+BIO_TEST(pinned_thread, affinity) {
+	BTEST_EXPECT(is_pinned_to_test_cpu());
+
+	bool pinned = false;
+	bio_run_async_and_wait(affinity_task, &pinned);
+	BTEST_EXPECT(pinned);
+}
+
+static int
+pinned_loop_thread(void* userdata) {
+	cpu_set_t* restored = userdata;
+	init_pinned_pool();
+	bio_terminate();
+	sched_getaffinity(0, sizeof(*restored), restored);
+	return 0;
+}
+
+// The main thread is not pinned in this suite
+TEST(thread, restore_affinity) {
+	cpu_set_t before;
+	sched_getaffinity(0, sizeof(before), &before);
+
+	// Run in a fresh thread which starts with the affinity of this one
+	thrd_t thread;
+	cpu_set_t after;
+	CHECK(thrd_create(&thread, pinned_loop_thread, &after) == thrd_success, "Could not create thread");
+	thrd_join(thread, NULL);
+
+	BTEST_EXPECT(CPU_EQUAL(&before, &after));
+}
+
+#endif
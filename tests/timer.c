@@ -1,4 +1,5 @@
 #include "common.h"
+#include <bio/timer.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <time.h>
@@ -91,3 +92,110 @@ TEST(timer, sort) {
 		CHECK(sort_fixture.numbers[i] >= sort_fixture.numbers[i - 1], "Bad sorting");
 	}
 }
+
+typedef struct {
+	int num_oneshot_calls;
+	int num_interval_calls;
+	int num_cancelled_calls;
+	bio_timer_t interval_timer;
+} callback_fixture_t;
+
+static void
+timer_oneshot_callback(void* userdata) {
+	callback_fixture_t* fixture = userdata;
+	++fixture->num_oneshot_calls;
+}
+
+static void
+timer_interval_callback(void* userdata) {
+	callback_fixture_t* fixture = userdata;
+	if (++fixture->num_interval_calls == 3) {
+		bio_cancel_timer(fixture->interval_timer);
+	}
+}
+
+static void
+timer_cancelled_callback(void* userdata) {
+	callback_fixture_t* fixture = userdata;
+	++fixture->num_cancelled_calls;
+}
+
+TEST(timer, callback) {
+	callback_fixture_t fixture = { 0 };
+
+	bio_timer_t oneshot = bio_create_timer(BIO_TIMER_ONESHOT, 10, timer_oneshot_callback, &fixture);
+	fixture.interval_timer = bio_create_timer(BIO_TIMER_INTERVAL, 5, timer_interval_callback, &fixture);
+	bio_timer_t cancelled = bio_create_timer(BIO_TIMER_ONESHOT, 5, timer_cancelled_callback, &fixture);
+	bio_timer_t long_timer = bio_create_timer(BIO_TIMER_ONESHOT, 100000, timer_oneshot_callback, &fixture);
+	CHECK(bio_is_timer_pending(oneshot), "Timer is not pending");
+	bio_cancel_timer(cancelled);
+	CHECK(!bio_is_timer_pending(cancelled), "Timer is still pending");
+	bio_reset_timer(long_timer, 50);
+
+	// Pending timers keep the loop running
+	bio_loop();
+
+	CHECK(fixture.num_oneshot_calls == 2, "Oneshot timers did not fire once");
+	CHECK(fixture.num_interval_calls == 3, "Interval timer was not cancelled");
+	CHECK(fixture.num_cancelled_calls == 0, "Cancelled timer fired");
+	CHECK(!bio_is_timer_pending(oneshot), "Timer is still pending");
+	CHECK(!bio_is_timer_pending(fixture.interval_timer), "Timer is still pending");
+}
+
+BIO_TEST(timer, microseconds) {
+	bio_time_t loop_time = bio_loop_time_us();
+	CHECK(loop_time <= bio_current_time_us(), "Loop time is in the future");
+	CHECK(bio_loop_time_us() == loop_time, "Loop time changed within an iteration");
+	CHECK(bio_loop_time_ms() == loop_time / 1000, "Loop time units mismatch");
+
+	bio_signal_t signal = bio_make_signal();
+	bio_raise_signal_after_us(signal, 300);
+	bio_wait_for_one_signal(signal);
+	CHECK(bio_current_time_us() - loop_time >= 300, "Woke up too early");
+	CHECK(bio_loop_time_us() - loop_time >= 300, "Loop time was not updated");
+}
+
+#define NUM_SLACK_TIMERS 20
+
+typedef struct {
+	bio_time_t delay_us;
+	bio_time_t start_time_us;
+	bio_time_t wakeup_time_us;
+} slack_timer_t;
+
+static void
+slack_entry(void* userdata) {
+	slack_timer_t* timer = userdata;
+	bio_signal_t signal = bio_make_signal();
+	bio_raise_signal_after_ex(signal, timer->delay_us, 100000);
+	bio_wait_for_one_signal(signal);
+	timer->wakeup_time_us = bio_loop_time_us();
+}
+
+BIO_TEST(timer, slack) {
+	slack_timer_t timers[NUM_SLACK_TIMERS];
+	bio_coro_t coros[NUM_SLACK_TIMERS];
+	for (int i = 0; i < NUM_SLACK_TIMERS; ++i) {
+		timers[i] = (slack_timer_t){
+			.delay_us = 1000 + i * 10,
+			.start_time_us = bio_loop_time_us(),
+		};
+		coros[i] = bio_spawn(slack_entry, &timers[i]);
+	}
+	for (int i = 0; i < NUM_SLACK_TIMERS; ++i) {
+		bio_join(coros[i]);
+	}
+
+	// The windows span less than two of the aligned boundaries
+	int num_wakeups = 0;
+	for (int i = 0; i < NUM_SLACK_TIMERS; ++i) {
+		CHECK(timers[i].wakeup_time_us - timers[i].start_time_us >= timers[i].delay_us, "Woke up too early");
+
+		bool seen = false;
+		for (int j = 0; j < i; ++j) {
+			seen = seen || timers[j].wakeup_time_us == timers[i].wakeup_time_us;
+		}
+		if (!seen) { ++num_wakeups; }
+	}
+	CHECK(num_wakeups <= 2, "Timers were not coalesced");
+}
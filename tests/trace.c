@@ -0,0 +1,105 @@
+#include "common.h"
+#include <bio/trace.h>
+#include <string.h>
+
+static suite_t trace = {
+	.name = "trace",
+	.init_per_test = init_bio,
+	.cleanup_per_test = cleanup_bio,
+};
+
+static char trace_content[1 << 18];
+
+static void
+traced_entry(void* userdata) {
+	bio_set_coro_name("traced");
+	bio_yield();
+
+	bio_file_t file;
+	bio_error_t error = { 0 };
+	bio_fopen(&file, "testfile", "w", &error);
+	CHECK_NO_ERROR(error);
+	bio_fwrite_exactly(file, "hello", 5, &error);
+	CHECK_NO_ERROR(error);
+	bio_fclose(file, &error);
+}
+
+static void
+yield_entry(void* userdata) {
+	int num_yields = *(int*)userdata;
+	for (int i = 0; i < num_yields; ++i) {
+		bio_yield();
+	}
+}
+
+static size_t
+read_trace(bio_file_t file) {
+	bio_error_t error = { 0 };
+	bio_fseek(file, 0, SEEK_SET, &error);
+	CHECK_NO_ERROR(error);
+
+	size_t len = 0;
+	size_t bytes_read;
+	while ((bytes_read = bio_fread(file, trace_content + len, sizeof(trace_content) - len - 1, &error)) > 0) {
+		len += bytes_read;
+	}
+	CHECK_NO_ERROR(error);
+	trace_content[len] = '\0';
+
+	return len;
+}
+
+BIO_TEST(trace, record) {
+	bio_file_t file;
+	bio_error_t error = { 0 };
+	bio_fopen(&file, "tracefile", "w+", &error);
+	CHECK_NO_ERROR(error);
+
+	CHECK(bio_start_trace(&(bio_trace_options_t){ .file = file }), "Could not start tracing");
+	CHECK(bio_is_tracing(), "Tracing is not active");
+	CHECK(!bio_start_trace(&(bio_trace_options_t){ .file = file }), "Tracing started twice");
+
+	bio_join(bio_spawn(traced_entry, NULL));
+
+	bio_stop_trace();
+	CHECK(!bio_is_tracing(), "Tracing is still active");
+
+	size_t len = read_trace(file);
+	bio_fclose(file, NULL);
+
+	CHECK(len > 4, "Trace is empty");
+	CHECK(strncmp(trace_content, "[\n", 2) == 0, "Invalid header");
+	CHECK(strcmp(trace_content + len - 3, "\n]\n") == 0, "Invalid footer");
+	CHECK(strstr(trace_content, "\"name\":\"traced\"") != NULL, "Resume is not recorded");
+	CHECK(strstr(trace_content, "\"reason\":\"yield\"") != NULL, "Yield is not recorded");
+	CHECK(strstr(trace_content, "\"reason\":\"wait\"") != NULL, "Wait is not recorded");
+	CHECK(strstr(trace_content, "\"reason\":\"exit\"") != NULL, "Exit is not recorded");
+	CHECK(strstr(trace_content, "\"name\":\"wake\"") != NULL, "Raise is not recorded");
+	CHECK(strstr(trace_content, "\"ph\":\"b\"") != NULL, "I/O submission is not recorded");
+	CHECK(strstr(trace_content, "\"ph\":\"e\"") != NULL, "I/O completion is not recorded");
+	// The flusher does not trace itself
+	CHECK(strstr(trace_content, "bio.trace") == NULL, "Flusher is traced");
+}
+
+BIO_TEST(trace, drop_when_full) {
+	bio_file_t file;
+	bio_error_t error = { 0 };
+	bio_fopen(&file, "tracefile", "w+", &error);
+	CHECK_NO_ERROR(error);
+
+	bio_start_trace(&(bio_trace_options_t){
+		.file = file,
+		.ring_size = 4,
+		.flush_interval_ms = 1000,
+	});
+
+	int num_yields = 100;
+	bio_join(bio_spawn(yield_entry, &num_yields));
+
+	bio_stop_trace();
+
+	read_trace(file);
+	bio_fclose(file, NULL);
+
+	CHECK(strstr(trace_content, "\"name\":\"dropped events\"") != NULL, "Dropped events are not reported");
+}